@@ -0,0 +1,203 @@
+#ifndef HW1_DISTRIBUTIONS_H_
+#define HW1_DISTRIBUTIONS_H_
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "../common/random.h"
+
+namespace queue_simulation {
+
+    // interarrival and service time types of BasicSimulator. each one is
+    // built from a mean and the numbers after the colon of its config string,
+    // e.g. "erlang:3", and its Sample is a plain inline member so the event
+    // loop of every instantiation calls it directly. a sample scales with the
+    // mean at a fixed shape (Discrete with its table), which the IPA
+    // derivatives of BasicSimulator rely on.
+
+    class Exponential {
+    public:
+        static constexpr uint32_t kId = 0;
+        static constexpr const char* kName = "exp";
+
+        Exponential(float mean, const std::vector<float>& = {}) : mean_(mean) {}
+
+        // GenRandomExp of the M/M/1 simulator, draw for draw
+        float Sample(common::Random& random) {
+            if(mean_ == 0) return 0.0;
+
+            float r = random.GetUniform();
+            return -1 * mean_ * std::log(r);
+        }
+
+        float GetMean() const { return mean_; }
+        std::vector<float> GetParameters() const { return {mean_}; }
+
+    private:
+        float mean_;
+    }; // class Exponential
+
+    // sum of k exponentials, k from the config and 2 by default
+    class Erlang {
+    public:
+        static constexpr uint32_t kId = 1;
+        static constexpr const char* kName = "erlang";
+
+        Erlang(float mean, const std::vector<float>& parameters = {})
+            : mean_(mean), k_(parameters.empty() ? 2 : (int)parameters[0]) {
+            if(k_ < 1) throw (k_);
+        }
+
+        float Sample(common::Random& random) {
+            double product = 1;
+            for(int i = 0; i < k_; i++) product *= random.GetUniform();
+            return -mean_ / k_ * std::log(product);
+        }
+
+        float GetMean() const { return mean_; }
+        std::vector<float> GetParameters() const { return {mean_, (float)k_}; }
+
+    private:
+        float mean_;
+        int k_;
+    }; // class Erlang
+
+    // two exponentials with balanced means for a coefficient of variation
+    // cv >= 1 from the config, 2 by default
+    class HyperExponential {
+    public:
+        static constexpr uint32_t kId = 2;
+        static constexpr const char* kName = "hyper";
+
+        HyperExponential(float mean, const std::vector<float>& parameters = {})
+            : mean_(mean), cv_(parameters.empty() ? 2 : parameters[0]) {
+            if(cv_ < 1) throw "HYPEREXPONENTIAL NEEDS CV >= 1";
+
+            double cv2 = cv_ * cv_;
+            p_ = 0.5 * (1 + std::sqrt((cv2 - 1) / (cv2 + 1)));
+            mean_1_ = mean_ / (2 * p_);
+            mean_2_ = mean_ / (2 * (1 - p_));
+        }
+
+        float Sample(common::Random& random) {
+            float mean = random.GetUniform() <= p_ ? mean_1_ : mean_2_;
+            return -mean * std::log(random.GetUniform());
+        }
+
+        float GetMean() const { return mean_; }
+        std::vector<float> GetParameters() const { return {mean_, cv_}; }
+
+    private:
+        float mean_, cv_, p_, mean_1_, mean_2_;
+    }; // class HyperExponential
+
+    // coefficient of variation from the config, 1 by default
+    class LogNormal {
+    public:
+        static constexpr uint32_t kId = 3;
+        static constexpr const char* kName = "lognormal";
+
+        LogNormal(float mean, const std::vector<float>& parameters = {})
+            : mean_(mean), cv_(parameters.empty() ? 1 : parameters[0]) {
+            sigma_ = std::sqrt(std::log(1 + (double)cv_ * cv_));
+            mu_ = std::log((double)mean_) - sigma_ * sigma_ / 2;
+        }
+
+        // Box-Muller, one normal per two uniforms
+        float Sample(common::Random& random) {
+            const double kTwoPi = 6.283185307179586;
+            double r = std::sqrt(-2 * std::log((double)random.GetUniform()));
+            double z = r * std::cos(kTwoPi * random.GetUniform());
+            return std::exp(mu_ + sigma_ * z);
+        }
+
+        float GetMean() const { return mean_; }
+        std::vector<float> GetParameters() const { return {mean_, cv_}; }
+
+    private:
+        float mean_, cv_;
+        double mu_, sigma_;
+    }; // class LogNormal
+
+    // shape from the config, 2 by default
+    class Weibull {
+    public:
+        static constexpr uint32_t kId = 4;
+        static constexpr const char* kName = "weibull";
+
+        Weibull(float mean, const std::vector<float>& parameters = {})
+            : mean_(mean), shape_(parameters.empty() ? 2 : parameters[0]) {
+            if(shape_ <= 0) throw (shape_);
+            scale_ = mean_ / std::tgamma(1 + 1 / (double)shape_);
+        }
+
+        float Sample(common::Random& random) {
+            return scale_ * std::pow(-std::log((double)random.GetUniform()), 1 / (double)shape_);
+        }
+
+        float GetMean() const { return mean_; }
+        std::vector<float> GetParameters() const { return {mean_, shape_}; }
+
+    private:
+        float mean_, shape_;
+        double scale_;
+    }; // class Weibull
+
+    class Deterministic {
+    public:
+        static constexpr uint32_t kId = 5;
+        static constexpr const char* kName = "det";
+
+        Deterministic(float mean, const std::vector<float>& = {}) : mean_(mean) {}
+
+        float Sample(common::Random&) { return mean_; }
+
+        float GetMean() const { return mean_; }
+        std::vector<float> GetParameters() const { return {mean_}; }
+
+    private:
+        float mean_;
+    }; // class Deterministic
+
+    // the EventModel of the other homeworks: value, probability pairs from the
+    // config, e.g. "discrete:1,0.25,2,0.75". the mean follows from the table
+    class Discrete {
+    public:
+        static constexpr uint32_t kId = 6;
+        static constexpr const char* kName = "discrete";
+
+        Discrete(float, const std::vector<float>& parameters = {}) {
+            if(parameters.empty() || parameters.size() % 2) throw "BAD DISCRETE TABLE";
+
+            double cum = 0, mean = 0;
+            for(size_t i = 0; i < parameters.size(); i += 2) {
+                cum += parameters[i + 1];
+                mean += parameters[i] * parameters[i + 1];
+                options_.push_back(parameters[i]);
+                cum_prob_.push_back(cum);
+            }
+            if(std::fabs(cum - 1) > 1e-4) throw "BAD DISCRETE TABLE";
+
+            cum_prob_.back() = 1;
+            mean_ = mean;
+            parameters_ = parameters;
+        }
+
+        float Sample(common::Random& random) {
+            float r = random.GetUniform();
+            size_t i = 0;
+            while(r > cum_prob_[i]) i++;
+            return options_[i];
+        }
+
+        float GetMean() const { return mean_; }
+        std::vector<float> GetParameters() const { return parameters_; }
+
+    private:
+        float mean_;
+        std::vector<float> options_, cum_prob_, parameters_;
+    }; // class Discrete
+
+}
+#endif // HW1_DISTRIBUTIONS_H_
@@ -0,0 +1,247 @@
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+#include "lanes.h"
+
+using namespace queue_simulation;
+
+namespace {
+
+    const double kLaneInf = std::numeric_limits<double>::infinity();
+
+    // natural log of a positive float after Cephes logf: integer ops move the
+    // mantissa into [sqrt(1/2), sqrt(2)) and split off the exponent, then a
+    // polynomial fits log(1 + x). no branches and no library call, so a loop
+    // over lanes vectorizes
+    inline float FastLog(float v) {
+        uint32_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        bits += 0x3f800000u - 0x3f3504f3u;
+        float e = (float)((int)(bits >> 23) - 0x7f);
+        bits = (bits & 0x007fffffu) + 0x3f3504f3u;
+        float m;
+        std::memcpy(&m, &bits, sizeof(m));
+        float x = m - 1;
+
+        float z = x * x;
+        float y = 7.0376836292e-2f;
+        y = y * x - 1.1514610310e-1f;
+        y = y * x + 1.1676998740e-1f;
+        y = y * x - 1.2420140846e-1f;
+        y = y * x + 1.4249322787e-1f;
+        y = y * x - 1.6668057665e-1f;
+        y = y * x + 2.0000714765e-1f;
+        y = y * x - 2.4999993993e-1f;
+        y = y * x + 3.3333331174e-1f;
+        y = y * x * z;
+
+        y += -2.12194440e-4f * e;
+        y += -0.5f * z;
+        return x + y + 0.693359375f * e;
+    }
+
+    // uniform on (0, 1) from the top 24 bits
+    inline float GetLaneUniform(uint32_t r) {
+        return ((r >> 8) + 0.5f) * (1.0f / 16777216.0f);
+    }
+
+}
+
+template <int kLanes>
+LaneSimulator<kLanes>::LaneSimulator(const float kLambda, const float kMu,
+                                     const unsigned kNumberServiced, uint64_t seed)
+    : random_(seed, 0), kLimit_(kNumberServiced), kLambda_(kLambda), kMu_(kMu) {
+    number_events_ = 0;
+    ring_mask_ = 1023;
+    rings_.resize(kLanes * (ring_mask_ + 1));
+
+    DrawTimes();
+    for(int l = 0; l < kLanes; l++) {
+        clock_[l] = total_delay_[l] = qt_area_[l] = bt_area_[l] = e_s_[l] = 0;
+        number_serviced_[l] = number_in_queue_[l] = head_[l] = 0;
+        arrival_event_[l] = arrival_interval_[l];
+        departure_event_[l] = kLaneInf;
+    }
+}
+
+// one interarrival and one service time per lane, whether the step uses
+// them or not, so the draws stay a loop over lanes
+template <int kLanes>
+void LaneSimulator<kLanes>::DrawTimes() {
+    random_.Fill(random_buffer_, 2 * kLanes);
+
+    for(int l = 0; l < kLanes; l++) {
+        arrival_interval_[l] = -kLambda_ * FastLog(GetLaneUniform(random_buffer_[l]));
+        service_time_[l] = -kMu_ * FastLog(GetLaneUniform(random_buffer_[kLanes + l]));
+    }
+}
+
+// doubles every ring, keeping each lane's queue in order from index 0
+template <int kLanes>
+void LaneSimulator<kLanes>::GrowRings() {
+    unsigned capacity = ring_mask_ + 1;
+    std::vector<double> rings(2 * kLanes * capacity);
+
+    for(int l = 0; l < kLanes; l++) {
+        for(unsigned i = 0; i < number_in_queue_[l]; i++)
+            rings[2 * l * capacity + i] = rings_[l * capacity + ((head_[l] + i) & ring_mask_)];
+        head_[l] = 0;
+    }
+
+    rings_.swap(rings);
+    ring_mask_ = 2 * capacity - 1;
+}
+
+// StepSimulate of Simulator on every lane that has not serviced kLimit_
+// customers yet. ties go to the departure, as in GetCurrentEventType
+template <int kLanes>
+void LaneSimulator<kLanes>::StepSimulate() {
+    unsigned capacity = ring_mask_ + 1;
+    bool full = false;
+
+    DrawTimes();
+
+    for(int l = 0; l < kLanes; l++) {
+        bool active = number_serviced_[l] < kLimit_;
+        double arrival_event = arrival_event_[l], departure_event = departure_event_[l];
+        bool busy = departure_event != kLaneInf;
+        bool arrival = active && arrival_event < departure_event;
+        bool departure = active && !arrival;
+        double time = arrival ? arrival_event : departure ? departure_event : clock_[l];
+        double interval = time - clock_[l];
+        unsigned in_queue = number_in_queue_[l], head = head_[l];
+
+        qt_area_[l] += in_queue * interval;
+        bt_area_[l] += busy ? interval : 0;
+        clock_[l] = time;
+
+        bool push = arrival && busy;
+        bool pop = departure && in_queue > 0;
+        bool start = (arrival && !busy) || pop;
+
+        // the tail slot is free, writing it when nothing is pushed is harmless
+        double front = rings_[l * capacity + (head & ring_mask_)];
+        rings_[l * capacity + ((head + in_queue) & ring_mask_)] = time;
+        total_delay_[l] += pop ? time - front : 0;
+        head_[l] = head + pop;
+        number_in_queue_[l] = in_queue + push - pop;
+
+        number_serviced_[l] += start;
+        e_s_[l] += start ? service_time_[l] : 0;
+        departure_event_[l] = start ? time + service_time_[l] : departure ? kLaneInf : departure_event;
+        arrival_event_[l] = arrival ? time + arrival_interval_[l] : arrival_event;
+        number_events_ += active;
+        full |= number_in_queue_[l] == capacity;
+    }
+
+    if(full) GrowRings();
+}
+
+template <int kLanes>
+void LaneSimulator<kLanes>::RunSimulation() {
+    if(kLimit_ == 0) return;
+
+    while(true) {
+        unsigned min_serviced = number_serviced_[0];
+        for(int l = 1; l < kLanes; l++)
+            min_serviced = std::min(min_serviced, number_serviced_[l]);
+        if(min_serviced >= kLimit_) break;
+
+        StepSimulate();
+    }
+}
+
+// SetMetrics of Simulator per lane
+template <int kLanes>
+std::vector<LaneMetrics> LaneSimulator<kLanes>::GetMetrics() {
+    std::vector<LaneMetrics> metrics(kLanes);
+
+    for(int l = 0; l < kLanes; l++) {
+        LaneMetrics& m = metrics[l];
+        m.wq = total_delay_[l] / kLimit_;
+        m.lq = qt_area_[l] / clock_[l];
+        m.p = bt_area_[l] / clock_[l];
+        m.l = m.lq + m.p;
+        m.e_s = e_s_[l] / kLimit_;
+        m.w = m.wq + m.e_s;
+    }
+
+    return metrics;
+}
+
+template <int kLanes>
+unsigned long long LaneSimulator<kLanes>::GetNumberEvents() {
+    return number_events_;
+}
+
+// every lane's metrics, then their mean with a 95% interval over the lanes
+template <int kLanes>
+void LaneSimulator<kLanes>::LogMetrics() {
+    std::vector<LaneMetrics> metrics = GetMetrics();
+    common::Summary wq, lq, p, l, e_s, w;
+
+    std::stringstream table;
+    table << "LANE METRICS" << std::endl
+          << "lane" << std::setw(12) << "Wq" << std::setw(12) << "Lq" << std::setw(12) << "p"
+          << std::setw(12) << "L" << std::setw(12) << "E[s]" << std::setw(12) << "W" << std::endl;
+
+    for(int i = 0; i < kLanes; i++) {
+        LaneMetrics& m = metrics[i];
+        table << std::setw(4) << i << std::setw(12) << m.wq << std::setw(12) << m.lq
+              << std::setw(12) << m.p << std::setw(12) << m.l << std::setw(12) << m.e_s
+              << std::setw(12) << m.w << std::endl;
+
+        wq.Add(m.wq);
+        lq.Add(m.lq);
+        p.Add(m.p);
+        l.Add(m.l);
+        e_s.Add(m.e_s);
+        w.Add(m.w);
+    }
+
+    table << "METRICS (95% over " << kLanes << " lanes)" << std::endl
+          << "Wq: " << wq.GetMean() << " +- " << wq.GetHalfWidth() << std::endl
+          << "Lq: " << lq.GetMean() << " +- " << lq.GetHalfWidth() << std::endl
+          << "p: " << p.GetMean() << " +- " << p.GetHalfWidth() << std::endl
+          << "L: " << l.GetMean() << " +- " << l.GetHalfWidth() << std::endl
+          << "E[s]: " << e_s.GetMean() << " +- " << e_s.GetHalfWidth() << std::endl
+          << "W: " << w.GetMean() << " +- " << w.GetHalfWidth() << std::endl
+        ;
+
+    std::cout << table.str();
+}
+
+template class queue_simulation::LaneSimulator<8>;
+template class queue_simulation::LaneSimulator<16>;
+
+template <int kLanes>
+void RunLanes(const float kLambda, const float kMu, const unsigned kNumberServiced) {
+    LaneSimulator<kLanes> simulator(kLambda, kMu, kNumberServiced, 1);
+
+    auto start = std::chrono::steady_clock::now();
+    simulator.RunSimulation();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    simulator.LogMetrics();
+    std::cout << "events: " << simulator.GetNumberEvents() << " in " << elapsed.count() << " s, "
+              << simulator.GetNumberEvents() / elapsed.count() << " per second" << std::endl;
+}
+
+// n_lane replications of kNumberServiced customers each
+void queue_simulation::RunLaneSimulation(int n_lane, const float kLambda, const float kMu,
+                                         const unsigned kNumberServiced) {
+    switch(n_lane) {
+    case 8:
+        RunLanes<8>(kLambda, kMu, kNumberServiced);
+        break;
+    case 16:
+        RunLanes<16>(kLambda, kMu, kNumberServiced);
+        break;
+    default:
+        throw (n_lane);
+    }
+}
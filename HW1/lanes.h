@@ -0,0 +1,52 @@
+#ifndef HW1_LANES_H_
+#define HW1_LANES_H_
+
+#include <string>
+#include <vector>
+
+#include "../common/random.h"
+#include "../common/statistics.h"
+
+namespace queue_simulation {
+
+    struct LaneMetrics {
+        double wq, lq, p, l, e_s, w;
+    };
+
+    // kLanes independent replications of the M/M/1 queue of Simulator, stepped
+    // in lock step: every step each lane takes its own next event, with the
+    // branches of StepSimulate turned into selects so the lanes stay in one
+    // loop. each lane draws from its own pcg32 stream and keeps its arrival
+    // times in its own ring, which doubles when a lane outgrows it.
+    template <int kLanes>
+    class LaneSimulator {
+    public:
+        LaneSimulator(const float, const float, const unsigned, uint64_t);
+
+        void RunSimulation();
+        void StepSimulate();
+        std::vector<LaneMetrics> GetMetrics();
+        unsigned long long GetNumberEvents();
+        void LogMetrics();
+
+    private:
+        void DrawTimes();
+        void GrowRings();
+
+        common::RandomLanes<kLanes> random_;
+        const unsigned kLimit_;
+        const float kLambda_, kMu_;
+        unsigned long long number_events_;
+        uint32_t random_buffer_[2 * kLanes];
+        float arrival_interval_[kLanes], service_time_[kLanes];
+        double clock_[kLanes], arrival_event_[kLanes], departure_event_[kLanes];
+        double total_delay_[kLanes], qt_area_[kLanes], bt_area_[kLanes], e_s_[kLanes];
+        unsigned number_serviced_[kLanes], number_in_queue_[kLanes], head_[kLanes];
+        unsigned ring_mask_;
+        std::vector<double> rings_;
+    }; // class LaneSimulator
+
+    void RunLaneSimulation(int, const float, const float, const unsigned);
+
+}
+#endif // HW1_LANES_H_
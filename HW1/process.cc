@@ -0,0 +1,99 @@
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "../common/process.h"
+#include "../common/random.h"
+
+// the M/M/1 queue of queue.cc written as processes instead of events: each
+// customer is a coroutine that waits for the server, holds it for its service
+// and leaves. build with -std=c++20.
+
+using common::Process;
+using common::Resource;
+using common::Scheduler;
+
+struct Totals {
+    double total_delay, total_service;
+    unsigned long long number_serviced;
+};
+
+double GenRandomExp(common::Random& random, double mean) {
+    return -mean * std::log((double)random.GetUniform());
+}
+
+Process Customer(Scheduler& scheduler, Resource& server, double service_time, Totals& totals) {
+    double arrival_time = scheduler.GetClock();
+
+    co_await server.Acquire();
+    totals.total_delay += scheduler.GetClock() - arrival_time;
+
+    co_await scheduler.Delay(service_time);
+    totals.total_service += service_time;
+    totals.number_serviced++;
+    server.Release();
+}
+
+Process Arrivals(Scheduler& scheduler, Resource& server, common::Random& random,
+                 const double kLambda, const double kMu, const unsigned kNumberServiced,
+                 Totals& totals) {
+    for(unsigned i = 0; i < kNumberServiced; i++) {
+        co_await scheduler.Delay(GenRandomExp(random, kLambda));
+        scheduler.Spawn(Customer(scheduler, server, GenRandomExp(random, kMu), totals));
+    }
+}
+
+int main(int argc, char* argv[]) {
+    const double kLambda = 1, kMu = 0.7;
+    unsigned number_serviced = 10000000;
+    uint64_t seed = 1;
+
+    // options come in pairs:
+    //   customers <n>
+    //   seed <n>
+    for(int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i], value = argv[i + 1];
+
+        if(option == "customers") {
+            number_serviced = std::stoul(value);
+        }
+        else if(option == "seed") {
+            seed = std::stoull(value);
+        }
+    }
+
+    common::Random random;
+    random.Seed(seed, 0);
+    Scheduler scheduler;
+    Resource server(scheduler, 1);
+    Totals totals = {0, 0, 0};
+
+    auto start = std::chrono::steady_clock::now();
+    scheduler.Spawn(Arrivals(scheduler, server, random, kLambda, kMu, number_serviced, totals));
+    scheduler.Run();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    // every customer has left, so the area under q(t) is the total delay
+    double clock = scheduler.GetClock();
+    double wq = totals.total_delay / totals.number_serviced;
+    double lq = totals.total_delay / clock;
+    double p = totals.total_service / clock;
+    double e_s = totals.total_service / totals.number_serviced;
+
+    std::stringstream metrics;
+    metrics << "METRICS" << std::endl
+            << "Wq: " << wq << std::endl
+            << "Lq: " << lq << std::endl
+            << "p: " << p << std::endl
+            << "L: " << lq + p << std::endl
+            << "E[s]: " << e_s << std::endl
+            << "W: " << wq + e_s << std::endl
+            << "resumptions: " << scheduler.GetNResume() << " in " << elapsed.count() << " s, "
+            << scheduler.GetNResume() / elapsed.count() << " per second" << std::endl
+        ;
+    std::cout << metrics.str();
+
+    return 0;
+}
@@ -4,15 +4,30 @@
 #include <limits>
 #include <sstream>
 #include <cmath>
+#include <memory>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <map>
 
 #include "queue.h"
+#include "lanes.h"
+#include "splitting.h"
+#include "transient.h"
 
 using namespace queue_simulation;
 
 const float kInf = std::numeric_limits<float>::max();
+const unsigned long long kProgressMask = (1 << 16) - 1; // publish every 65536 events
+const uint64_t kReplicationSeed = 0x2545f4914f6cdd1dULL;
+
+// heap allocations of the program, counted by the operator new of main
+// below, so the allocations option can tell whether the event loop still
+// allocates. programs linking the simulator without main keep their own
+// operator new and read 0
+std::atomic<unsigned long long> n_heap_allocation(0);
 
 Logger::Logger() {
-    log_file_ = std::ofstream("log.txt");
 }
 
 Logger::~Logger() {
@@ -20,11 +35,13 @@ Logger::~Logger() {
 }
 
 void Logger::Log(std::string log) {
+    if(!log_file_.is_open()) log_file_.open("log.txt");
     log_file_ << log;
     log_file_ << std::endl;
 }
 
-std::string Simulator::GetStringVector(std::vector<float> vec) {
+template <class Arrival, class Service>
+std::string BasicSimulator<Arrival, Service>::GetStringVector(std::vector<float> vec) {
     std::stringstream ss;
     for(size_t i = 0; i < vec.size(); ++i)
     {
@@ -37,14 +54,27 @@ std::string Simulator::GetStringVector(std::vector<float> vec) {
     return s;
 }
 
-void Simulator::Log() {
+// newest first, the order the checkpoint and the log have always used
+template <class Arrival, class Service>
+std::vector<float> BasicSimulator<Arrival, Service>::GetArrivalTimes() {
+    std::vector<float> arrival_times;
+    arrival_times.reserve(arrival_times_.size());
+    arrival_times_.ForEach([&](float t) { arrival_times.push_back(t); });
+
+    return std::vector<float>(arrival_times.rbegin(), arrival_times.rend());
+}
+
+template <class Arrival, class Service>
+void BasicSimulator<Arrival, Service>::Log() {
+    if(!logging_) return;
+
     std::stringstream system_state;
     system_state << "NEW SYSTEM STATE" << std::endl
                  << "clock: " << clock_ << std::endl
                  << "event list: " << GetStringVector(event_list_) << std::endl
                  << "server status: " << server_status_ << std::endl
                  << "number in queue: " << number_in_queue_ << std::endl
-                 << "times of arrival: " << GetStringVector(arrival_times_) << std::endl
+                 << "times of arrival: " << GetStringVector(GetArrivalTimes()) << std::endl
                  << "time of last event: " << last_event_time_ << std::endl
                  << "number serviced: " << number_serviced_ << std::endl
                  << "total delay: " << total_delay_ << std::endl
@@ -56,40 +86,40 @@ void Simulator::Log() {
     logger_.Log(system_state_string);
 }
 
-Simulator::Simulator(const float kLambda, const float kMu, const unsigned kNumberServiced)
-    : kLimit_(kNumberServiced), kLambda_(kLambda), kMu_(kMu) {
+template <class Arrival, class Service>
+BasicSimulator<Arrival, Service>::BasicSimulator(Arrival arrival, Service service,
+                                                 const unsigned kNumberServiced)
+    : kLimit_(kNumberServiced), arrival_(arrival), service_(service) {
     event_list_.resize(2, kInf); // arrival = 0, departure = 1
     clock_ = last_event_time_ = bt_area_ = number_in_queue_ = qt_area_
         = number_serviced_ = total_delay_ = 0;
     server_status_ = false;
     wq_ = lq_ = p_ = l_ = w_ = e_s_ = 0;
+    d_departure_mu_ = d_busy_start_ = d_delay_mu_ = d_delay_lambda_ = 0;
+    d_wq_mu_ = d_w_mu_ = d_lq_lambda_ = 0;
+    checkpoint_interval_ = 0;
+    number_events_ = 0;
+    resumed_ = false;
+    logging_ = true;
+    progress_events_ = progress_serviced_ = progress_wq_ = nullptr;
+    profiler_ = nullptr;
+    allocation_warm_up_ = n_allocation_ = 0;
+    sla_ = kInf;
+    n_over_sla_ = 0;
 }
 
-float Simulator::GenRandomExp(float l) {
-    if(l == 0) return 0.0;
-
-    float r;
-    do {
-        r = std::rand();
-    } while (r == 0);
-
-    r /= (float)RAND_MAX;
-
-    float seq1 = -1 * l;
-    float seq2 = std::log(r);
-
-    return seq1 * seq2;
-}
-
-float Simulator::GetArrivalInterval() {
-    return GenRandomExp(kLambda_);
+template <class Arrival, class Service>
+float BasicSimulator<Arrival, Service>::GetArrivalInterval() {
+    return arrival_.Sample(random_);
 }
 
-float Simulator::GetServiceTime() {
-    return GenRandomExp(kMu_);
+template <class Arrival, class Service>
+float BasicSimulator<Arrival, Service>::GetServiceTime() {
+    return service_.Sample(random_);
 }
 
-int Simulator::GetCurrentEventType() {
+template <class Arrival, class Service>
+int BasicSimulator<Arrival, Service>::GetCurrentEventType() {
     float front = event_list_[0];
     float back = event_list_[1];
 
@@ -99,120 +129,413 @@ int Simulator::GetCurrentEventType() {
     return 1;
 }
 
-void Simulator::SetArrivalEvent() {
+template <class Arrival, class Service>
+void BasicSimulator<Arrival, Service>::SetArrivalEvent() {
     float arrival_interval = GetArrivalInterval();
     event_list_[0] = arrival_interval + clock_;
 }
 
-void Simulator::SetDepartureEvent() {
+template <class Arrival, class Service>
+void BasicSimulator<Arrival, Service>::SetDepartureEvent() {
     float service_time = GetServiceTime();
     event_list_[1] = service_time + clock_;
 
     e_s_ += service_time;
+    d_departure_mu_ += service_time;
 }
 
-void Simulator::UpdateBTArea() {
+template <class Arrival, class Service>
+void BasicSimulator<Arrival, Service>::UpdateBTArea() {
     bt_area_ += clock_ - last_event_time_;
 }
 
-void Simulator::UpdateQTArea() {
+template <class Arrival, class Service>
+void BasicSimulator<Arrival, Service>::UpdateQTArea() {
     int number_in_queue = number_in_queue_;
     float interval = clock_ - last_event_time_;
     qt_area_ += number_in_queue * interval;
 }
 
-void Simulator::UpdateArrivalTimes() {
+template <class Arrival, class Service>
+void BasicSimulator<Arrival, Service>::UpdateArrivalTimes() {
     float arrival_time = event_list_[0];
     event_list_[0] = kInf;
-    arrival_times_.insert(arrival_times_.begin(), arrival_time);
+    arrival_times_.push_back(arrival_time);
 
     SetArrivalEvent();
 }
 
-void Simulator::UpdateTotalDelay() {
-    float arrival_time = arrival_times_.back();
-    arrival_times_.pop_back();
+template <class Arrival, class Service>
+void BasicSimulator<Arrival, Service>::UpdateTotalDelay() {
+    float arrival_time = arrival_times_.front();
+    arrival_times_.pop_front();
     float delay = clock_ - arrival_time;
     total_delay_ += delay;
+    if(delay > sla_) n_over_sla_++;
+
+    // the service starts at the pending departure
+    d_delay_mu_ += d_departure_mu_;
+    d_delay_lambda_ += d_busy_start_ - arrival_time;
 }
 
-void Simulator::RunSimulation() {
-    if(kLimit_ == 0) return;
+template <class Arrival, class Service>
+void BasicSimulator<Arrival, Service>::StepSimulate() {
+    int event_type = GetCurrentEventType();
+    float event_time = event_list_[event_type];
+    last_event_time_ = clock_;
+    clock_ = event_time;
+    queue_histogram_.Add(number_in_queue_, clock_ - last_event_time_);
+
+    // arrival
+    if(!event_type) {
+
+        // server is idle
+        if(!server_status_) {
+            server_status_ = true;
+            number_serviced_++;
+            d_busy_start_ = clock_;
+            d_departure_mu_ = 0;
+
+            // update event list
+            SetArrivalEvent();
+            SetDepartureEvent();
+        }
+
+        // server is busy
+        else {
+            UpdateQTArea();
+            UpdateBTArea();
+            UpdateArrivalTimes();
+        }
+    }
+
+    // departure
+    else {
+        UpdateBTArea();
+        UpdateQTArea();
+        if(number_in_queue_) {
+            UpdateTotalDelay();
+            SetDepartureEvent();
+            number_serviced_++;
+        }
+        else {
+            server_status_ = false;
+            event_list_[1] = kInf;
+        }
+    }
+    number_in_queue_ = arrival_times_.size();
+    number_events_++;
+}
+
+// adds the first arrival, a resumed run already has its event list
+template <class Arrival, class Service>
+void BasicSimulator<Arrival, Service>::StartSimulation() {
+    if(resumed_) return;
 
-    // add first arrival
     float arrival_interval = GetArrivalInterval();
     event_list_[0] = arrival_interval;
     Log();
+}
 
-    float event_time;
-    int event_type;
+template <class Arrival, class Service>
+void BasicSimulator<Arrival, Service>::RunSimulation() {
+    if(kLimit_ == 0) return;
+
+    if(profiler_) profiler_->Begin("start");
+    StartSimulation();
 
     // simulation
+    if(profiler_) profiler_->Begin("main loop");
+    unsigned long long first_event = number_events_;
     while(number_serviced_ < kLimit_) {
-        event_type = GetCurrentEventType();
-        event_time = event_list_[event_type];
-        last_event_time_ = clock_;
-        clock_ = event_time;
-
-        // arrival
-        if(!event_type) {
-
-            // server is idle
-            if(!server_status_) {
-                server_status_ = true;
-                number_serviced_++;
-
-                // update event list
-                SetArrivalEvent();
-                SetDepartureEvent();
-            }
-
-            // server is busy
-            else {
-                UpdateQTArea();
-                UpdateBTArea();
-                UpdateArrivalTimes();
-                }
-            }
-
-            // departure
-        else {
-            UpdateBTArea();
-            UpdateQTArea();
-            if(number_in_queue_) {
-                SetDepartureEvent();
-                number_serviced_++;
-                UpdateTotalDelay();
-            }
-            else {
-                server_status_ = false;
-                event_list_[1] = kInf;
-            }
-        }
-        number_in_queue_ = arrival_times_.size();
+        StepSimulate();
+
+        if(checkpoint_interval_ && number_events_ % checkpoint_interval_ == 0)
+            WriteCheckpoint();
+
+        if(progress_events_ && (number_events_ & kProgressMask) == 0)
+            PublishProgress();
+
+        if(allocation_warm_up_ && number_events_ == allocation_warm_up_)
+            n_allocation_ = n_heap_allocation.load();
 
         //Log();
     }
 
+    if(progress_events_) PublishProgress();
+
+    if(allocation_warm_up_ && number_events_ >= allocation_warm_up_)
+        std::cout << "heap allocations after " << allocation_warm_up_ << " events: "
+                  << n_heap_allocation.load() - n_allocation_ << " (arena slabs: "
+                  << common::GetThreadArena().GetNSlab() << ")" << std::endl;
+
+    if(checkpoint_interval_) {
+        WriteCheckpoint();
+        checkpoint_writer_.Flush();
+    }
+
+    if(profiler_) {
+        profiler_->AddEvents("main loop", number_events_ - first_event);
+        profiler_->Begin("metrics and log");
+    }
+
     Log();
     SetMetrics();
     LogMetrics();
+
+    if(profiler_) profiler_->End();
+}
+
+template <class Arrival, class Service>
+void BasicSimulator<Arrival, Service>::SetProgress(common::ProgressRegistry& registry) {
+    progress_events_ = registry.AddCounter("hw1.events");
+    progress_serviced_ = registry.AddCounter("hw1.customers");
+    progress_wq_ = registry.AddGauge("hw1.wq");
+}
+
+template <class Arrival, class Service>
+void BasicSimulator<Arrival, Service>::PublishProgress() {
+    progress_events_->SetCount(number_events_);
+    progress_serviced_->SetCount(number_serviced_);
+    if(number_serviced_) progress_wq_->Set(total_delay_ / number_serviced_);
+}
+
+// counts heap allocations from the given event to the end of the run
+template <class Arrival, class Service>
+void BasicSimulator<Arrival, Service>::SetAllocationCheck(unsigned long long warm_up) {
+    allocation_warm_up_ = warm_up;
+}
+
+// phases of RunSimulation, the main loop with its events
+template <class Arrival, class Service>
+void BasicSimulator<Arrival, Service>::SetProfiler(common::PhaseProfiler& profiler) {
+    profiler_ = &profiler;
+}
+
+// counts the customers whose delay in queue exceeds sla
+template <class Arrival, class Service>
+void BasicSimulator<Arrival, Service>::SetSla(float sla) {
+    sla_ = sla;
+}
+
+template <class Arrival, class Service>
+void BasicSimulator<Arrival, Service>::SetLogging(bool logging) {
+    logging_ = logging;
+}
+
+// a load change in the middle of a run, the events already on the event
+// list keep their times
+template <class Arrival, class Service>
+void BasicSimulator<Arrival, Service>::SetDistributions(Arrival arrival, Service service) {
+    arrival_ = arrival;
+    service_ = service;
+}
+
+// a clone restored from Serialize continues on its own stream
+template <class Arrival, class Service>
+void BasicSimulator<Arrival, Service>::Reseed(uint64_t seed, uint64_t stream) {
+    random_.Seed(seed, stream);
+}
+
+template <class Arrival, class Service>
+unsigned BasicSimulator<Arrival, Service>::GetNumberInQueue() {
+    return number_in_queue_;
+}
+
+template <class Arrival, class Service>
+unsigned BasicSimulator<Arrival, Service>::GetNumberServiced() {
+    return number_serviced_;
+}
+
+template <class Arrival, class Service>
+float BasicSimulator<Arrival, Service>::GetClock() {
+    return clock_;
+}
+
+template <class Arrival, class Service>
+float BasicSimulator<Arrival, Service>::GetNextEventTime() {
+    return event_list_[GetCurrentEventType()];
+}
+
+template <class Arrival, class Service>
+float BasicSimulator<Arrival, Service>::GetTotalDelay() {
+    return total_delay_;
+}
+
+template <class Arrival, class Service>
+bool BasicSimulator<Arrival, Service>::GetServerStatus() {
+    return server_status_;
+}
+
+template <class Arrival, class Service>
+unsigned long long BasicSimulator<Arrival, Service>::GetNOverSla() {
+    return n_over_sla_;
+}
+
+template <class Arrival, class Service>
+const common::TimeHistogram& BasicSimulator<Arrival, Service>::GetQueueHistogram() {
+    return queue_histogram_;
+}
+
+template <class Arrival, class Service>
+void BasicSimulator<Arrival, Service>::SetCheckpoint(std::string path, unsigned interval) {
+    checkpoint_path_ = path;
+    checkpoint_interval_ = interval;
+}
+
+template <class Arrival, class Service>
+void BasicSimulator<Arrival, Service>::WriteCheckpoint() {
+    checkpoint_writer_.Submit(checkpoint_path_, Serialize());
+}
+
+template <class Arrival, class Service>
+std::string BasicSimulator<Arrival, Service>::Serialize() {
+    common::CheckpointBuffer buffer;
+    buffer.Put(kLimit_);
+    buffer.Put(Arrival::kId);
+    buffer.PutVector(arrival_.GetParameters());
+    buffer.Put(Service::kId);
+    buffer.PutVector(service_.GetParameters());
+    buffer.PutRandom(random_);
+    buffer.Put(number_events_);
+    buffer.Put(clock_);
+    buffer.Put(last_event_time_);
+    buffer.Put(total_delay_);
+    buffer.Put(qt_area_);
+    buffer.Put(bt_area_);
+    buffer.Put(e_s_);
+    buffer.Put(d_departure_mu_);
+    buffer.Put(d_busy_start_);
+    buffer.Put(d_delay_mu_);
+    buffer.Put(d_delay_lambda_);
+    buffer.Put(number_serviced_);
+    buffer.Put(number_in_queue_);
+    buffer.Put(server_status_);
+    buffer.PutVector(event_list_);
+    buffer.PutVector(GetArrivalTimes());
+    buffer.PutVector(queue_histogram_.GetWeights());
+
+    return buffer.Finish(kCheckpointMagic, kCheckpointVersion);
+}
+
+// restores a state written by Serialize, only for a simulator with the same parameters
+template <class Arrival, class Service>
+bool BasicSimulator<Arrival, Service>::Deserialize(const std::string& bytes) {
+    common::CheckpointReader reader;
+    if(!reader.Open(bytes, kCheckpointMagic, kCheckpointVersion)) return false;
+
+    unsigned limit;
+    uint32_t arrival_id, service_id;
+    std::vector<float> arrival_parameters, service_parameters, arrival_times;
+    std::vector<double> queue_weights;
+    if(!reader.Get(limit) || !reader.Get(arrival_id) || !reader.GetVector(arrival_parameters)
+       || !reader.Get(service_id) || !reader.GetVector(service_parameters))
+        return false;
+    if(limit != kLimit_ || arrival_id != Arrival::kId || service_id != Service::kId
+       || arrival_parameters != arrival_.GetParameters()
+       || service_parameters != service_.GetParameters())
+        return false;
+
+    bool ok = reader.GetRandom(random_)
+        && reader.Get(number_events_)
+        && reader.Get(clock_)
+        && reader.Get(last_event_time_)
+        && reader.Get(total_delay_)
+        && reader.Get(qt_area_)
+        && reader.Get(bt_area_)
+        && reader.Get(e_s_)
+        && reader.Get(d_departure_mu_)
+        && reader.Get(d_busy_start_)
+        && reader.Get(d_delay_mu_)
+        && reader.Get(d_delay_lambda_)
+        && reader.Get(number_serviced_)
+        && reader.Get(number_in_queue_)
+        && reader.Get(server_status_)
+        && reader.GetVector(event_list_)
+        && reader.GetVector(arrival_times)
+        && reader.GetVector(queue_weights)
+        && reader.IsDone();
+    if(!ok || event_list_.size() != 2) throw "CORRUPT CHECKPOINT";
+
+    arrival_times_.clear();
+    for(auto t = arrival_times.rbegin(); t != arrival_times.rend(); t++)
+        arrival_times_.push_back(*t);
+    queue_histogram_.SetWeights(queue_weights);
+
+    return true;
+}
+
+template <class Arrival, class Service>
+bool BasicSimulator<Arrival, Service>::Resume(std::string path) {
+    std::string bytes;
+    if(!common::ReadCheckpointFile(path, bytes)) return false;
+
+    resumed_ = Deserialize(bytes);
+    return resumed_;
 }
 
-void Simulator::SetMetrics() {
+template <class Arrival, class Service>
+void BasicSimulator<Arrival, Service>::SetMetrics() {
     wq_ = total_delay_ / kLimit_;
     lq_ = qt_area_ / clock_;
     p_ = bt_area_ / clock_;
     l_ = lq_ + p_;
     e_s_ = e_s_ / kLimit_;
     w_ = wq_ + e_s_;
+
+    // the area under q(t) is the delay of the customers served plus the wait
+    // so far of the ones still in queue, and the clock is the last start of
+    // service, so both move with d_busy_start_
+    double mu = service_.GetMean(), lambda = arrival_.GetMean();
+    double d_area = d_delay_lambda_;
+    arrival_times_.ForEach([&](float t) { d_area += d_busy_start_ - t; });
+    d_wq_mu_ = d_delay_mu_ / kLimit_ / mu;
+    d_w_mu_ = d_wq_mu_ + e_s_ / mu;
+    d_lq_lambda_ = (d_area - lq_ * d_busy_start_) / clock_ / lambda;
+}
+
+template <class Arrival, class Service>
+float BasicSimulator<Arrival, Service>::GetWq() {
+    return wq_;
+}
+
+template <class Arrival, class Service>
+float BasicSimulator<Arrival, Service>::GetLq() {
+    return lq_;
+}
+
+template <class Arrival, class Service>
+float BasicSimulator<Arrival, Service>::GetW() {
+    return w_;
 }
 
-void Simulator::PrintMetrics(std::string metrics) {
+template <class Arrival, class Service>
+float BasicSimulator<Arrival, Service>::GetL() {
+    return l_;
+}
+
+template <class Arrival, class Service>
+float BasicSimulator<Arrival, Service>::GetDWqDMu() {
+    return d_wq_mu_;
+}
+
+template <class Arrival, class Service>
+float BasicSimulator<Arrival, Service>::GetDWDMu() {
+    return d_w_mu_;
+}
+
+template <class Arrival, class Service>
+float BasicSimulator<Arrival, Service>::GetDLqDLambda() {
+    return d_lq_lambda_;
+}
+
+template <class Arrival, class Service>
+void BasicSimulator<Arrival, Service>::PrintMetrics(std::string metrics) {
     std::cout << metrics;
 }
 
-void Simulator::LogMetrics() {
+template <class Arrival, class Service>
+void BasicSimulator<Arrival, Service>::LogMetrics() {
     std::stringstream metrics;
     metrics << "METRICS" << std::endl
             << "Wq: " << wq_ << std::endl
@@ -221,20 +544,303 @@ void Simulator::LogMetrics() {
             << "L: " << lq_ + p_ << std::endl
             << "E[s]: " << e_s_ << std::endl
             << "W: " << w_ << std::endl
+            << "DERIVATIVES (IPA)" << std::endl
+            << "dWq/dmu: " << d_wq_mu_ << std::endl
+            << "dW/dmu: " << d_w_mu_ << std::endl
+            << "dLq/dlambda: " << d_lq_lambda_ << std::endl
+            << "NUMBER IN QUEUE (time weighted)" << std::endl
         ;
 
+    for(unsigned k = 0; k < 5; k++)
+        metrics << "P(Q = " << k << "): " << queue_histogram_.GetProbability(k) << std::endl;
+    for(unsigned k : {10, 20, 50, 100})
+        metrics << "P(Q >= " << k << "): " << queue_histogram_.GetTail(k) << std::endl;
+    for(double q : {0.99, 0.999, 0.9999})
+        metrics << q * 100 << "% of the time Q <= " << queue_histogram_.GetQuantile(q) << std::endl;
+
     std::string metrics_string = metrics.str();
     logger_.Log(metrics_string);
 
     PrintMetrics(metrics_string);
 }
 
-int main() {
+// every Simulator user outside this file gets the M/M/1 instantiation
+template class queue_simulation::BasicSimulator<Exponential, Exponential>;
+
+// "name:p1,p2,..." to the numbers after the colon
+std::vector<float> GetDistributionParameters(const std::string& config) {
+    std::vector<float> parameters;
+    size_t colon = config.find(':');
+    if(colon == std::string::npos) return parameters;
+
+    std::stringstream list(config.substr(colon + 1));
+    std::string item;
+    while(std::getline(list, item, ',')) parameters.push_back(std::stof(item));
+
+    return parameters;
+}
+
+std::string GetDistributionName(const std::string& config) {
+    return config.substr(0, config.find(':'));
+}
+
+template <class Arrival, class Service>
+void RunEngine(const SimulationConfig& config) {
+    BasicSimulator<Arrival, Service> simulator(
+        Arrival(config.lambda, GetDistributionParameters(config.arrival)),
+        Service(config.mu, GetDistributionParameters(config.service)),
+        config.number_serviced);
+    common::ProgressRegistry progress;
+    std::unique_ptr<common::ProgressSampler> sampler;
+
+    if(!config.checkpoint_path.empty()) {
+        simulator.SetCheckpoint(config.checkpoint_path, config.checkpoint_interval);
+        if(simulator.Resume(config.checkpoint_path))
+            std::cout << "resumed from " << config.checkpoint_path << std::endl;
+    }
+    if(!config.progress_target.empty()) {
+        simulator.SetProgress(progress);
+        sampler.reset(new common::ProgressSampler(progress, config.progress_target,
+                                                  config.progress_interval_ms));
+        sampler->Start();
+    }
+    if(config.profiler) simulator.SetProfiler(*config.profiler);
+    if(config.allocation_warm_up) simulator.SetAllocationCheck(config.allocation_warm_up);
+
+    simulator.RunSimulation();
+}
+
+// replication r runs on stream r of one seed, whichever worker runs it
+template <class Arrival, class Service>
+common::PartialResult ReplicateEngine(const SimulationConfig& config, int64_t first, int64_t count) {
+    Arrival arrival(config.lambda, GetDistributionParameters(config.arrival));
+    Service service(config.mu, GetDistributionParameters(config.service));
+    common::PartialResult result;
+
+    for(int64_t r = first; r < first + count; r++) {
+        BasicSimulator<Arrival, Service> simulator(arrival, service, config.number_serviced);
+        simulator.SetLogging(false);
+        simulator.Reseed(kReplicationSeed, r);
+        simulator.StartSimulation();
+        while(simulator.GetNumberServiced() < config.number_serviced) simulator.StepSimulate();
+        simulator.SetMetrics();
+
+        result.Add("Wq", simulator.GetWq());
+        result.Add("Lq", simulator.GetLq());
+        result.Add("W", simulator.GetW());
+        result.Add("L", simulator.GetL());
+        result.Add("dWq/dmu", simulator.GetDWqDMu());
+        result.Add("dW/dmu", simulator.GetDWDMu());
+        result.Add("dLq/dlambda", simulator.GetDLqDLambda());
+    }
+
+    return result;
+}
+
+// the two entry points of one arrival and service pair
+struct Engine {
+    void (*run)(const SimulationConfig&);
+    common::PartialResult (*replicate)(const SimulationConfig&, int64_t, int64_t);
+};
+
+template <class Arrival, class Service>
+Engine MakeEngine() {
+    return Engine{RunEngine<Arrival, Service>, ReplicateEngine<Arrival, Service>};
+}
+
+template <class Arrival>
+void AddEngines(std::map<std::string, Engine>& engines) {
+    std::string prefix = std::string(Arrival::kName) + "/";
+    engines[prefix + Exponential::kName] = MakeEngine<Arrival, Exponential>();
+    engines[prefix + Erlang::kName] = MakeEngine<Arrival, Erlang>();
+    engines[prefix + HyperExponential::kName] = MakeEngine<Arrival, HyperExponential>();
+    engines[prefix + LogNormal::kName] = MakeEngine<Arrival, LogNormal>();
+    engines[prefix + Weibull::kName] = MakeEngine<Arrival, Weibull>();
+    engines[prefix + Deterministic::kName] = MakeEngine<Arrival, Deterministic>();
+    engines[prefix + Discrete::kName] = MakeEngine<Arrival, Discrete>();
+}
+
+// one instantiation per arrival and service pair, so the event loop of each
+// one has its Sample calls inlined instead of going through a virtual call.
+// the table is built once, also when several threads ask at the same time
+const Engine& GetEngine(const SimulationConfig& config) {
+    static const std::map<std::string, Engine> engines = [] {
+        std::map<std::string, Engine> engines;
+        AddEngines<Exponential>(engines);
+        AddEngines<Erlang>(engines);
+        AddEngines<HyperExponential>(engines);
+        AddEngines<LogNormal>(engines);
+        AddEngines<Weibull>(engines);
+        AddEngines<Deterministic>(engines);
+        AddEngines<Discrete>(engines);
+        return engines;
+    }();
+
+    std::string key = GetDistributionName(config.arrival) + "/" + GetDistributionName(config.service);
+    auto engine = engines.find(key);
+    if(engine == engines.end()) throw "UNKNOWN DISTRIBUTION";
+
+    return engine->second;
+}
+
+void queue_simulation::RunConfiguredSimulation(const SimulationConfig& config) {
+    GetEngine(config).run(config);
+}
+
+common::PartialResult queue_simulation::RunReplications(const SimulationConfig& config,
+                                                        int64_t first, int64_t count) {
+    return GetEngine(config).replicate(config, first, count);
+}
+
+// bench and batch link the simulator without this main and its operator new
+#ifndef SIMULATION_NO_MAIN
+
+void* operator new(std::size_t size) {
+    n_heap_allocation.fetch_add(1, std::memory_order_relaxed);
+    if(void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+// not inlined, so gcc does not see std::free on a pointer from operator new
+__attribute__((noinline)) void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+int main(int argc, char* argv[]) {
     const unsigned kNumberServiced = 200000000;
     const float kLambda = 1, kMu = 0.7;
+    const unsigned kCheckpointInterval = 20000000;
+    const unsigned kSplittingServiced = 1000000;
+    const unsigned kReplicationServiced = 1000000;
+
+    const int kProgressIntervalMs = 1000;
+
+    SimulationConfig config = {kLambda, kMu, kNumberServiced, "exp", "exp", "", kCheckpointInterval,
+                               "", kProgressIntervalMs, nullptr, 0};
+    common::PhaseProfiler profiler;
+    int n_lane = 0, split = 2;
+    float sla = 0;
+    int n_replication = 0, n_grid = 20;
+    int n_sharded = 0, n_shard = 0, n_worker = 0;
+    float horizon = 200, change_time = 0, change_mu = kMu;
+
+    // options come in pairs:
+    //   arrival <config>: interarrival times, exp by default, e.g. erlang:3,
+    //     hyper:4 or discrete:0.5,0.5,1.5,0.5, see distributions.h
+    //   service <config>: service times, same configs
+    //   checkpoint <path>: checkpoint periodically, resume if path exists
+    //   progress <target>: publish progress to stderr (-), unix:<socket> or a file
+    //   lanes <8|16>: split the customers over that many lock step replications
+    //   sla <t>: estimate P(Wq > t) by RESTART splitting on a shorter run
+    //   split <n>: trials per level crossing for sla, 2 by default
+    //   ensemble <n>: n short replications from an empty queue, Lq, L and Wq
+    //     over time with 95% intervals instead of the long run averages
+    //   horizon <t>: length of each ensemble replication, 200 by default
+    //   grid <k>: number of equally spaced ensemble sample times, 20 by default
+    //   change <t>: the ensemble's mean service time becomes change_mu at t
+    //   change_mu <m>: mean service time after the change
+    //   replications <n>: n independent runs of kReplicationServiced customers
+    //     of the arrival and service configs in worker processes, with 95%
+    //     intervals over the runs
+    //   shards <n>: pieces the replications are cut into, 4 per worker by default
+    //   workers <n>: worker processes, one per hardware thread by default
+    //   profile on: hardware counters of each phase, wall clock where not allowed
+    //   allocations <n>: count heap allocations after the first n events,
+    //     best without checkpoint and progress, which allocate on their own
+    // lanes, sla and ensemble are M/M/1 only and ignore arrival and service
+    for(int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i], value = argv[i + 1];
+
+        if(option == "arrival") {
+            config.arrival = value;
+        }
+        else if(option == "service") {
+            config.service = value;
+        }
+        else if(option == "checkpoint") {
+            config.checkpoint_path = value;
+        }
+        else if(option == "progress") {
+            config.progress_target = value;
+        }
+        else if(option == "lanes") {
+            n_lane = std::stoi(value);
+        }
+        else if(option == "sla") {
+            sla = std::stof(value);
+        }
+        else if(option == "split") {
+            split = std::stoi(value);
+        }
+        else if(option == "ensemble") {
+            n_replication = std::stoi(value);
+        }
+        else if(option == "horizon") {
+            horizon = std::stof(value);
+        }
+        else if(option == "grid") {
+            n_grid = std::stoi(value);
+        }
+        else if(option == "change") {
+            change_time = std::stof(value);
+        }
+        else if(option == "change_mu") {
+            change_mu = std::stof(value);
+        }
+        else if(option == "replications") {
+            n_sharded = std::stoi(value);
+        }
+        else if(option == "shards") {
+            n_shard = std::stoi(value);
+        }
+        else if(option == "workers") {
+            n_worker = std::stoi(value);
+        }
+        else if(option == "profile") {
+            config.profiler = &profiler;
+        }
+        else if(option == "allocations") {
+            config.allocation_warm_up = std::stoull(value);
+        }
+    }
 
-    Simulator simulator(kLambda, kMu, kNumberServiced);
-    simulator.RunSimulation();
+    if(n_lane) {
+        RunLaneSimulation(n_lane, kLambda, kMu, kNumberServiced / n_lane);
+        return 0;
+    }
+
+    if(sla > 0) {
+        RunSplittingSimulation(kLambda, kMu, kSplittingServiced, sla, split);
+        return 0;
+    }
+
+    if(n_sharded) {
+        SimulationConfig replication_config = config;
+        replication_config.number_serviced = kReplicationServiced;
+        common::ShardRunner runner(n_worker);
+        if(!n_shard) n_shard = 4 * runner.GetNWorker();
+        common::PartialResult result = runner.Run(n_sharded, n_shard, [&](int64_t first, int64_t count) {
+            return RunReplications(replication_config, first, count);
+        });
+        std::cout << "REPLICATIONS (" << n_sharded << " of " << kReplicationServiced << " customers, "
+                  << n_shard << " shards on " << runner.GetNWorker() << " workers, "
+                  << runner.GetNRerun() << " rerun)" << std::endl
+                  << result.GetReport();
+        return 0;
+    }
+
+    if(n_replication) {
+        RunTransientSimulation(kLambda, kMu, n_replication, horizon, n_grid, change_time, change_mu);
+        return 0;
+    }
+
+    RunConfiguredSimulation(config);
+    if(config.profiler) std::cout << profiler.GetReport();
 
     return 0;
 }
+#endif // SIMULATION_NO_MAIN
@@ -5,8 +5,19 @@
 #include <fstream>
 #include <sstream>
 
+#include "../common/random.h"
+#include "../common/checkpoint.h"
+#include "../common/progress.h"
+#include "../common/pool.h"
+#include "../common/histogram.h"
+#include "../common/perf.h"
+#include "../common/shard.h"
+#include "distributions.h"
+
 namespace queue_simulation {
 
+    // log.txt is opened on the first Log, so a simulator that never logs
+    // (the replications of an ensemble) never touches the file
     class Logger {
     public:
         Logger();
@@ -18,12 +29,38 @@ namespace queue_simulation {
         std::ofstream log_file_;
     };
 
-    class Simulator {
+    // the single server queue with interarrival times from Arrival and
+    // service times from Service, see distributions.h
+    template <class Arrival, class Service>
+    class BasicSimulator {
 
     public:
-        Simulator(const float, const float, const unsigned);
+        BasicSimulator(Arrival, Service, const unsigned);
 
         void RunSimulation();
+        void StartSimulation();
+        void StepSimulate();
+        void SetCheckpoint(std::string, unsigned);
+        bool Resume(std::string);
+        std::string Serialize();
+        bool Deserialize(const std::string&);
+        void WriteCheckpoint();
+        void SetProgress(common::ProgressRegistry&);
+        void SetAllocationCheck(unsigned long long);
+        void SetProfiler(common::PhaseProfiler&);
+        void SetSla(float);
+        void SetLogging(bool);
+        void SetDistributions(Arrival, Service);
+        void Reseed(uint64_t, uint64_t);
+        unsigned GetNumberInQueue();
+        unsigned GetNumberServiced();
+        float GetClock();
+        float GetNextEventTime();
+        float GetTotalDelay();
+        bool GetServerStatus();
+        unsigned long long GetNOverSla();
+        const common::TimeHistogram& GetQueueHistogram();
+        void PublishProgress();
         int GetCurrentEventType(); // returns the earliest event
         void SetArrivalEvent();
         void SetDepartureEvent();
@@ -33,25 +70,77 @@ namespace queue_simulation {
         void UpdateArrivalTimes();
         void LogMetrics();
         void SetMetrics();
+        float GetWq(), GetLq(), GetW(), GetL();
+        // IPA estimates of the last run, in the same pass: dWq/dmu and dW/dmu
+        // by the mean service time, dLq/dlambda by the mean interarrival time
+        float GetDWqDMu(), GetDWDMu(), GetDLqDLambda();
         void PrintMetrics(std::string);
-        float GenRandomExp(float);
         float GetArrivalInterval();
         float GetServiceTime();
         std::string GetStringVector(std::vector<float>);
+        std::vector<float> GetArrivalTimes();
         void Log();
 
     private:
+        static const uint32_t kCheckpointMagic = 0x31574851; // "QHW1"
+        static const uint32_t kCheckpointVersion = 4;
         Logger logger_;
+        common::Random random_;
+        common::CheckpointWriter checkpoint_writer_;
+        std::string checkpoint_path_;
+        unsigned checkpoint_interval_;
+        unsigned long long number_events_;
+        bool resumed_;
+        bool logging_;
+        common::ProgressValue *progress_events_, *progress_serviced_, *progress_wq_;
+        common::PhaseProfiler* profiler_;
+        unsigned long long allocation_warm_up_, n_allocation_;
+        float sla_;
+        unsigned long long n_over_sla_;
         const unsigned kLimit_;
-        const float kLambda_, kMu_;
+        Arrival arrival_;
+        Service service_;
         float clock_, last_event_time_, total_delay_, qt_area_, bt_area_;
         unsigned number_serviced_, number_in_queue_;
         bool server_status_;
         float wq_, lq_, p_, l_, e_s_, w_;
 
+        // derivatives by the log of the means, where every time drawn from a
+        // distribution is its own derivative: d_departure_mu_ of the pending
+        // departure, d_busy_start_ of the arrival that opened the busy period
+        // (every start of service in it moves with that arrival when lambda
+        // changes), and the totals over the delays of SetMetrics
+        double d_departure_mu_, d_busy_start_, d_delay_mu_, d_delay_lambda_;
+        float d_wq_mu_, d_w_mu_, d_lq_lambda_;
+
         std::vector<float> event_list_;
-        std::vector<float> arrival_times_;
+        common::ChunkQueue<float> arrival_times_; // oldest first
+        common::TimeHistogram queue_histogram_; // time at each number in queue
     };
 
+    // the M/M/1 queue of the homework
+    using Simulator = BasicSimulator<Exponential, Exponential>;
+
+    // what main hands to the engine the arrival and service config strings
+    // pick, "name" or "name:p1,p2,..." as in distributions.h
+    struct SimulationConfig {
+        float lambda, mu;
+        unsigned number_serviced;
+        std::string arrival, service;
+        std::string checkpoint_path;
+        unsigned checkpoint_interval;
+        std::string progress_target;
+        int progress_interval_ms;
+        common::PhaseProfiler* profiler;
+        unsigned long long allocation_warm_up;
+    };
+
+    void RunConfiguredSimulation(const SimulationConfig&);
+
+    // replications [first, first + count) of config.number_serviced customers
+    // each, a shard of common::ShardRunner. the checkpoint, progress and
+    // profiler fields are not used
+    common::PartialResult RunReplications(const SimulationConfig&, int64_t, int64_t);
+
 }
 #endif // HW1_BASE_QUEUE_H_
@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+
+#include "splitting.h"
+
+using namespace queue_simulation;
+
+const int SplittingSimulator::kNBatch = 20;
+const uint64_t kRetrialSeed = 0x9e3779b97f4a7c15ULL;
+
+// a customer that waits sla finds about sla / kLambda arrivals behind it when
+// its service starts, so the levels go up to there. with rho = kMu / kLambda
+// the queue climbs step more places with probability about rho^step, and
+// step is picked so that this is 1 / kSplit
+SplittingSimulator::SplittingSimulator(const float kLambda, const float kMu,
+                                       const unsigned kNumberServiced, const float kSla,
+                                       const int kSplit)
+    : kLambda_(kLambda), kMu_(kMu), kSla_(kSla), kLimit_(kNumberServiced), kSplit_(kSplit),
+      main_(kLambda, kMu, kNumberServiced) {
+    if(kSplit_ < 2) throw (kSplit_);
+    if(kMu_ >= kLambda_) throw "SPLITTING NEEDS A STABLE QUEUE";
+
+    double rho = kMu_ / kLambda_;
+    unsigned step = std::max(1.0, std::round(std::log((double)kSplit_) / std::log(1 / rho)));
+    unsigned top = kSla_ / kLambda_;
+
+    weights_.push_back(1);
+    for(unsigned threshold = step; threshold <= top; threshold += step) {
+        thresholds_.push_back(threshold);
+        weights_.push_back(weights_.back() / kSplit_);
+        clones_.emplace_back(new Simulator(kLambda, kMu, kNumberServiced));
+        clones_.back()->SetSla(kSla_);
+    }
+
+    main_.SetSla(kSla_);
+    count_ = 0;
+    n_retrial_ = n_step_ = 0;
+    batch_end_ = 0;
+    seconds_ = 0;
+}
+
+int SplittingSimulator::GetLevel(unsigned number_in_queue) {
+    int level = 0;
+    while(level < (int)thresholds_.size() && number_in_queue >= thresholds_[level]) level++;
+
+    return level;
+}
+
+// kSplit_ - 1 extra trials from the state of simulator, which just entered level
+void SplittingSimulator::Split(Simulator& simulator, int level) {
+    std::string state = simulator.Serialize();
+    Simulator& clone = *clones_[level - 1];
+
+    for(int i = 1; i < kSplit_; i++) {
+        clone.Deserialize(state);
+        clone.Reseed(kRetrialSeed, ++n_retrial_);
+        RunTrial(clone, level);
+    }
+}
+
+// the main path (level 0) runs until kLimit_ customers are serviced, a trial
+// of level k until it falls below level k. the queue moves one place per
+// step, so a climb is always into the next level
+void SplittingSimulator::RunTrial(Simulator& simulator, int level) {
+    while(true) {
+        int before = GetLevel(simulator.GetNumberInQueue());
+        unsigned long long n_over_sla = simulator.GetNOverSla();
+
+        simulator.StepSimulate();
+        n_step_++;
+
+        int after = GetLevel(simulator.GetNumberInQueue());
+        if(after < level) return;
+
+        count_ += (simulator.GetNOverSla() - n_over_sla) * weights_[after];
+        if(after > before) Split(simulator, after);
+
+        if(level == 0 && simulator.GetNumberServiced() >= batch_end_) {
+            estimate_.Add(count_ / (kLimit_ / kNBatch));
+            count_ = 0;
+            if(estimate_.GetCount() == kNBatch) return;
+            batch_end_ += kLimit_ / kNBatch;
+        }
+    }
+}
+
+void SplittingSimulator::RunSimulation() {
+    if(kLimit_ < (unsigned)kNBatch) return;
+
+    auto start = std::chrono::steady_clock::now();
+    batch_end_ = kLimit_ / kNBatch;
+    main_.StartSimulation();
+    RunTrial(main_, 0);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    seconds_ = elapsed.count();
+}
+
+// the M/M/1 queue has P(Wq > t) = rho exp(-(1 / kMu - 1 / kLambda) t), the
+// naive count is the customers plain simulation needs for the same error
+void SplittingSimulator::LogMetrics() {
+    double rho = kMu_ / kLambda_;
+    double exact = rho * std::exp(-(1 / kMu_ - 1 / kLambda_) * kSla_);
+    double p = estimate_.GetMean();
+    double relative_error = p > 0 ? estimate_.GetStdError() / p : 0;
+
+    std::stringstream metrics;
+    metrics << "SPLITTING (" << thresholds_.size() << " levels, split " << kSplit_ << ")" << std::endl
+            << "P(Wq > " << kSla_ << "): " << p << " +- " << estimate_.GetHalfWidth() << std::endl
+            << "relative error: " << relative_error << std::endl
+            << "exact: " << exact << std::endl
+            << "events: " << n_step_ << " in " << seconds_ << " s, retrials: " << n_retrial_ << std::endl;
+    if(relative_error > 0)
+        metrics << "naive customers for the same error: "
+                << (1 - p) / (p * relative_error * relative_error) << std::endl;
+
+    std::cout << metrics.str();
+}
+
+void queue_simulation::RunSplittingSimulation(const float kLambda, const float kMu,
+                                              const unsigned kNumberServiced, const float kSla,
+                                              const int kSplit) {
+    SplittingSimulator simulator(kLambda, kMu, kNumberServiced, kSla, kSplit);
+    simulator.RunSimulation();
+    simulator.LogMetrics();
+}
@@ -0,0 +1,50 @@
+#ifndef HW1_SPLITTING_H_
+#define HW1_SPLITTING_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "queue.h"
+#include "../common/statistics.h"
+
+namespace queue_simulation {
+
+    // RESTART estimate of P(Wq > sla) for the queue of Simulator. the number
+    // in queue is cut into levels at thresholds_; whenever a trial climbs into
+    // level k it is split into kSplit_ trials, the extra ones restored from its
+    // Serialize into a clone and reseeded, and an extra trial of level k is
+    // dropped as soon as it falls below level k. a long wait seen in level k
+    // counts 1 / kSplit_^k, which keeps the estimate unbiased. the main path
+    // is cut into batches for the interval.
+    class SplittingSimulator {
+    public:
+        SplittingSimulator(const float, const float, const unsigned, const float, const int);
+
+        void RunSimulation();
+        void LogMetrics();
+
+    private:
+        void RunTrial(Simulator&, int);
+        void Split(Simulator&, int);
+        int GetLevel(unsigned);
+
+        static const int kNBatch;
+        const float kLambda_, kMu_, kSla_;
+        const unsigned kLimit_;
+        const int kSplit_;
+        Simulator main_;
+        std::vector<std::unique_ptr<Simulator>> clones_; // one per level
+        std::vector<unsigned> thresholds_;
+        std::vector<double> weights_;
+        double count_;
+        unsigned long long n_retrial_, n_step_;
+        unsigned batch_end_;
+        double seconds_;
+        common::Summary estimate_;
+    }; // class SplittingSimulator
+
+    void RunSplittingSimulation(const float, const float, const unsigned, const float, const int);
+
+}
+#endif // HW1_SPLITTING_H_
@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "transient.h"
+#include "../common/thread_pool.h"
+
+using namespace queue_simulation;
+
+const int TransientSimulator::kNBlockPerThread = 4;
+const uint64_t kEnsembleSeed = 0x853c49e6748fea9bULL;
+const unsigned kNoLimit = ~0u;
+
+TransientSimulator::TransientSimulator(const float kLambda, const float kMu,
+                                       const int kNReplication, const float kHorizon,
+                                       const int kNGrid)
+    : kLambda_(kLambda), kMu_(kMu), kHorizon_(kHorizon), kNReplication_(kNReplication),
+      kNGrid_(kNGrid) {
+    if(kNGrid_ < 1) throw (kNGrid_);
+    if(kHorizon_ <= 0) throw "TRANSIENT NEEDS A POSITIVE HORIZON";
+
+    totals_.queue.resize(kNGrid_);
+    totals_.system.resize(kNGrid_);
+    totals_.busy.resize(kNGrid_);
+    totals_.delay.resize(kNGrid_);
+    totals_.n_event = 0;
+    change_time_ = change_mu_ = 0;
+    n_thread_ = 0;
+    seconds_ = 0;
+}
+
+void TransientSimulator::SetLoadChange(float time, float mu) {
+    change_time_ = time;
+    change_mu_ = mu;
+}
+
+float TransientSimulator::GetGridTime(int k) {
+    return kHorizon_ * (k + 1) / kNGrid_;
+}
+
+// every event up to and including time, so the state is the one at time
+void TransientSimulator::AdvanceTo(Simulator& simulator, float time, GridTotals& totals) {
+    while(simulator.GetNextEventTime() <= time) {
+        simulator.StepSimulate();
+        totals.n_event++;
+    }
+}
+
+// the delay of a grid point is the mean delay in queue of the customers whose
+// service started since the previous grid point, pooled over the runs as
+// their total delay over their number, so a busy run weighs what its
+// customers weigh
+void TransientSimulator::RunReplication(int replication, GridTotals& totals) {
+    Simulator simulator(kLambda_, kMu_, kNoLimit);
+    simulator.SetLogging(false);
+    simulator.Reseed(kEnsembleSeed, replication);
+    simulator.StartSimulation();
+
+    bool changed = change_time_ <= 0;
+    unsigned serviced = 0;
+    float delay = 0;
+
+    for(int k = 0; k < kNGrid_; k++) {
+        float time = GetGridTime(k);
+        if(!changed && change_time_ <= time) {
+            AdvanceTo(simulator, change_time_, totals);
+            simulator.SetDistributions(Exponential(kLambda_), Exponential(change_mu_));
+            changed = true;
+        }
+        AdvanceTo(simulator, time, totals);
+
+        unsigned number_in_queue = simulator.GetNumberInQueue();
+        bool busy = simulator.GetServerStatus();
+        totals.queue[k].Add(number_in_queue);
+        totals.system[k].Add(number_in_queue + busy);
+        totals.busy[k].Add(busy);
+
+        unsigned n = simulator.GetNumberServiced() - serviced;
+        totals.delay[k].Add(simulator.GetTotalDelay() - delay, n);
+        serviced = simulator.GetNumberServiced();
+        delay = simulator.GetTotalDelay();
+    }
+}
+
+void TransientSimulator::RunBlock(int first, int last, GridTotals& totals) {
+    totals.queue.assign(kNGrid_, common::Summary());
+    totals.system.assign(kNGrid_, common::Summary());
+    totals.busy.assign(kNGrid_, common::Summary());
+    totals.delay.assign(kNGrid_, common::RatioSummary());
+    totals.n_event = 0;
+
+    for(int r = first; r < last; r++) RunReplication(r, totals);
+}
+
+void TransientSimulator::RunSimulation() {
+    auto start = std::chrono::steady_clock::now();
+
+    common::ThreadPool pool;
+    n_thread_ = pool.GetNThread();
+    int n_block = std::min(kNReplication_, n_thread_ * kNBlockPerThread);
+    std::vector<GridTotals> blocks(n_block);
+    std::vector<std::future<void>> done;
+
+    for(int b = 0; b < n_block; b++) {
+        int first = (long long)kNReplication_ * b / n_block;
+        int last = (long long)kNReplication_ * (b + 1) / n_block;
+        done.push_back(pool.Submit([this, first, last, &blocks, b] {
+            RunBlock(first, last, blocks[b]);
+        }));
+    }
+
+    for(int b = 0; b < n_block; b++) {
+        done[b].get();
+        for(int k = 0; k < kNGrid_; k++) {
+            totals_.queue[k].Merge(blocks[b].queue[k]);
+            totals_.system[k].Merge(blocks[b].system[k]);
+            totals_.busy[k].Merge(blocks[b].busy[k]);
+            totals_.delay[k].Merge(blocks[b].delay[k]);
+        }
+        totals_.n_event += blocks[b].n_event;
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    seconds_ = elapsed.count();
+}
+
+// means with 95% half widths at every grid point, then the long run values
+// of the M/M/1 queue at the final load for comparison
+void TransientSimulator::LogMetrics() {
+    std::stringstream metrics;
+    metrics << "TRANSIENT (" << kNReplication_ << " replications to " << kHorizon_ << ")" << std::endl;
+    if(change_time_ > 0)
+        metrics << "mean service time " << kMu_ << " until " << change_time_ << ", then " << change_mu_
+                << std::endl;
+    metrics << std::setw(10) << "t" << std::setw(12) << "Lq(t)" << std::setw(12) << "+-"
+            << std::setw(12) << "L(t)" << std::setw(12) << "+-" << std::setw(12) << "p(t)"
+            << std::setw(12) << "Wq(t)" << std::setw(12) << "+-" << std::endl;
+
+    for(int k = 0; k < kNGrid_; k++) {
+        metrics << std::setw(10) << GetGridTime(k)
+                << std::setw(12) << totals_.queue[k].GetMean()
+                << std::setw(12) << totals_.queue[k].GetHalfWidth()
+                << std::setw(12) << totals_.system[k].GetMean()
+                << std::setw(12) << totals_.system[k].GetHalfWidth()
+                << std::setw(12) << totals_.busy[k].GetMean()
+                << std::setw(12) << totals_.delay[k].GetRatio()
+                << std::setw(12) << totals_.delay[k].GetHalfWidth() << std::endl;
+    }
+
+    double rho = (change_time_ > 0 ? change_mu_ : kMu_) / kLambda_;
+    if(rho < 1)
+        metrics << "long run: Lq " << rho * rho / (1 - rho) << ", L " << rho / (1 - rho)
+                << ", Wq " << rho * rho / (1 - rho) * kLambda_ << std::endl;
+    metrics << "events: " << totals_.n_event << " in " << seconds_ << " s on " << n_thread_
+            << " threads" << std::endl;
+
+    std::cout << metrics.str();
+}
+
+void queue_simulation::RunTransientSimulation(const float kLambda, const float kMu,
+                                              const int kNReplication, const float kHorizon,
+                                              const int kNGrid, const float kChangeTime,
+                                              const float kChangeMu) {
+    TransientSimulator simulator(kLambda, kMu, kNReplication, kHorizon, kNGrid);
+    if(kChangeTime > 0) simulator.SetLoadChange(kChangeTime, kChangeMu);
+    simulator.RunSimulation();
+    simulator.LogMetrics();
+}
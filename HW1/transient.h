@@ -0,0 +1,52 @@
+#ifndef HW1_TRANSIENT_H_
+#define HW1_TRANSIENT_H_
+
+#include <vector>
+
+#include "queue.h"
+#include "../common/statistics.h"
+
+namespace queue_simulation {
+
+    // the queue of Simulator from an empty start: kNReplication_ independent
+    // short runs to kHorizon_, each one on its own random stream, with the
+    // state read at kNGrid_ equally spaced times. the runs are cut into
+    // blocks over a thread pool, every block adds into its own summaries and
+    // the blocks are merged in order, so the result does not depend on the
+    // number of threads. an optional load change sets the mean service time
+    // to change_mu_ at change_time_ in every run.
+    class TransientSimulator {
+    public:
+        TransientSimulator(const float, const float, const int, const float, const int);
+
+        void SetLoadChange(float, float);
+        void RunSimulation();
+        void LogMetrics();
+
+    private:
+        // per grid point, over the replications
+        struct GridTotals {
+            std::vector<common::Summary> queue, system, busy;
+            std::vector<common::RatioSummary> delay;
+            unsigned long long n_event;
+        }; // struct GridTotals
+
+        void RunBlock(int, int, GridTotals&);
+        void RunReplication(int, GridTotals&);
+        void AdvanceTo(Simulator&, float, GridTotals&);
+        float GetGridTime(int);
+
+        static const int kNBlockPerThread;
+        const float kLambda_, kMu_, kHorizon_;
+        const int kNReplication_, kNGrid_;
+        float change_time_, change_mu_;
+        GridTotals totals_;
+        int n_thread_;
+        double seconds_;
+    }; // class TransientSimulator
+
+    void RunTransientSimulation(const float, const float, const int, const float, const int,
+                                const float, const float);
+
+}
+#endif // HW1_TRANSIENT_H_
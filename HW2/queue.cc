@@ -3,8 +3,10 @@
 #include <cmath>
 #include <sstream>
 #include <iomanip>
+#include <cstdlib>
 
 #include "queue.h"
+#include "what_if.h"
 
 using namespace single_channel_queue_simulation;
 
@@ -12,9 +14,10 @@ using namespace single_channel_queue_simulation;
 int Customer::customer_id_ = 0;
 int Simulator::n_wait_ = 0;
 int Simulator::clock_ = 0;
+const unsigned kReplicationSeed = 1;
+const uint32_t kModelVersion = 2; // bump when a change alters the results of a scenario
 
 Logger::Logger() {
-  log_file_ = std::ofstream("log.txt");
 }
 
 Logger::~Logger() {
@@ -22,6 +25,7 @@ Logger::~Logger() {
 }
 
 void Logger::Log(std::string log) {
+  if(!log_file_.is_open()) log_file_.open("log.txt");
   log_file_ << log;
   log_file_ << std::endl;
 }
@@ -70,12 +74,26 @@ int EventModel::GetEvent() {
   throw "GET EVENT FAILED";
 }
 
+float EventModel::GetMean() {
+  float mean = 0;
+  for(int i = 0; i < n_options_; i++) mean += options_[i] * probs_[i];
+  return mean;
+}
+
+void EventModel::AddToKey(common::ScenarioKey& key) {
+  key.Add(n_decimal_);
+  key.Add(options_);
+  key.Add(probs_);
+}
+
 Simulator::Simulator(int n_customer, EventModel& arrival_model, EventModel& service_model)
   : arrival_model_(arrival_model), service_model_(service_model) {
+  logging_ = true;
   n_customer_ = n_customer;
   arrival_model_ = arrival_model;
   service_model_ = service_model;
   total_it_ = total_its_ = total_st_ = total_tcss_ = total_wtq_ = 0;
+  d_total_wtq_mu_ = d_total_wtq_lambda_ = d_clock_lambda_ = 0;
 }
 
 Customer::Customer(int service_time) {
@@ -83,9 +101,11 @@ Customer::Customer(int service_time) {
   inter_arrival_time_ = arrival_time_ = time_service_begins_ =
     waiting_time_in_queue_ = idle_time_of_server_ = 0;
   service_time_ = time_service_ends_ = time_customer_spends_in_system_ = service_time;
+  d_waiting_time_mu_ = d_waiting_time_lambda_ = d_service_ends_lambda_ = 0;
+  d_service_ends_mu_ = service_time;
 }
 
-Customer::Customer(int arrival_interval, int service_time, Customer prev_customer) {
+Customer::Customer(int arrival_interval, int service_time, const Customer& prev_customer) {
   customer_id_++;
 
   inter_arrival_time_ = arrival_interval;
@@ -101,12 +121,30 @@ Customer::Customer(int arrival_interval, int service_time, Customer prev_custome
     ? arrival_time_ - prev_customer.time_service_ends_
     : 0;
 
+  // scaling a mean scales every time drawn from it, so a drawn time is its
+  // own derivative and an arrival time moves with lambda by itself. an
+  // arrival right at the previous departure, common with integer tables,
+  // takes the derivative for an increase of the means
+  double d_begins_mu = 0, d_begins_lambda = arrival_time_;
+  if(arrival_time_ <= prev_customer.time_service_ends_) d_begins_mu = prev_customer.d_service_ends_mu_;
+  if(arrival_time_ < prev_customer.time_service_ends_
+     || (arrival_time_ == prev_customer.time_service_ends_
+         && prev_customer.d_service_ends_lambda_ > d_begins_lambda))
+    d_begins_lambda = prev_customer.d_service_ends_lambda_;
+
+  d_waiting_time_mu_ = d_begins_mu;
+  d_waiting_time_lambda_ = d_begins_lambda - arrival_time_;
+  d_service_ends_mu_ = d_begins_mu + service_time_;
+  d_service_ends_lambda_ = d_begins_lambda;
+
   Simulator::clock_ = time_service_ends_;
 
   if(arrival_time_ < prev_customer.time_service_ends_) Simulator::n_wait_++;
 }
 
 void Simulator::LogCustomer(Customer& c) {
+  if(!logging_) return;
+
   std::stringstream details;
   details << c.customer_id_
           << std::setw(6) << c.inter_arrival_time_
@@ -124,6 +162,8 @@ void Simulator::LogCustomer(Customer& c) {
 }
 
 void Simulator::InitializeLogTable() {
+  if(!logging_) return;
+
   std::stringstream heads;
   heads << "C"
         << std::setw(6) << "IT"
@@ -147,9 +187,14 @@ void Simulator::UpdateHistory(Customer& c) {
   total_st_ += c.service_time_;
   total_tcss_ += c.time_customer_spends_in_system_;
   total_wtq_ += c.waiting_time_in_queue_;
+  d_total_wtq_mu_ += c.d_waiting_time_mu_;
+  d_total_wtq_lambda_ += c.d_waiting_time_lambda_;
+  d_clock_lambda_ = c.d_service_ends_lambda_;
 }
 
 void Simulator::LogTotals() {
+  if(!logging_) return;
+
   std::stringstream totals;
   totals << ""
           << std::setw(10) << total_it_
@@ -166,15 +211,60 @@ void Simulator::LogTotals() {
   logger_.Log(totals_string);
 }
 
+void Simulator::SetLogging(bool logging) {
+  logging_ = logging;
+}
+
+float Simulator::GetAverageWait() {
+  return (float)total_wtq_ / n_customer_;
+}
+
+float Simulator::GetWaitProbability() {
+  return (float)n_wait_ / n_customer_;
+}
+
+float Simulator::GetIdleProbability() {
+  return (float)total_its_ / clock_;
+}
+
+float Simulator::GetAverageTimeInSystem() {
+  return (float)total_tcss_ / n_customer_;
+}
+
+// the queue holds every customer for its wait and all are served by the
+// clock, so the area under q(t) is the total wait
+float Simulator::GetAverageQueueLength() {
+  return (float)total_wtq_ / clock_;
+}
+
+float Simulator::GetWaitDerivative() {
+  return d_total_wtq_mu_ / n_customer_ / service_model_.GetMean();
+}
+
+float Simulator::GetTimeInSystemDerivative() {
+  return (d_total_wtq_mu_ + total_st_) / n_customer_ / service_model_.GetMean();
+}
+
+float Simulator::GetQueueLengthDerivative() {
+  return (d_total_wtq_lambda_ - GetAverageQueueLength() * d_clock_lambda_) / clock_
+    / arrival_model_.GetMean();
+}
+
 void Simulator::LogMetrics() {
+  if(!logging_) return;
+
   std::stringstream metrics;
-  metrics << "average waiting time: " << (float)total_wtq_ / n_customer_ << std::endl
-         << "waiting probability: " << (float)n_wait_ / n_customer_ << std::endl
-         << "server idle probability: " << (float)total_its_ / clock_ << std::endl
+  metrics << "average waiting time: " << GetAverageWait() << std::endl
+         << "waiting probability: " << GetWaitProbability() << std::endl
+         << "server idle probability: " << GetIdleProbability() << std::endl
          <<  "average service time: " << (float)total_st_ / n_customer_ << std::endl
          << "average inter arrival time: " << (float)total_it_ / (n_customer_ - 1) << std::endl
          << "average waiting time for queue people: " << (float)total_wtq_ / n_wait_ << std::endl
-         << "average time in system: " << (float)total_tcss_ / n_customer_ << std::endl
+         << "average time in system: " << GetAverageTimeInSystem() << std::endl
+         << "average number in queue: " << GetAverageQueueLength() << std::endl
+         << "dWq/dmu (IPA): " << GetWaitDerivative() << std::endl
+         << "dW/dmu (IPA): " << GetTimeInSystemDerivative() << std::endl
+         << "dLq/dlambda (IPA): " << GetQueueLengthDerivative() << std::endl
     ;
 
   std::string metrics_string = metrics.str();
@@ -184,6 +274,8 @@ void Simulator::LogMetrics() {
 void Simulator::RunSimulation() {
   if(n_customer_ == 0) return;
 
+  // the counts shared with Customer start over with every run
+  n_wait_ = clock_ = 0;
   InitializeLogTable();
 
   Customer customer(service_model_.GetEvent());
@@ -203,7 +295,47 @@ void Simulator::RunSimulation() {
   LogMetrics();
 }
 
-int main() {
+// replication r seeds std::rand with kReplicationSeed + r, so replication 0
+// is the plain run of main
+common::PartialResult single_channel_queue_simulation::RunReplications(
+  int n_customer, EventModel& arrival_model, EventModel& service_model, int64_t first,
+  int64_t count) {
+  common::PartialResult result;
+
+  for(int64_t r = first; r < first + count; r++) {
+    std::srand(kReplicationSeed + r);
+    Simulator simulator(n_customer, arrival_model, service_model);
+    simulator.SetLogging(false);
+    simulator.RunSimulation();
+
+    result.Add("average waiting time", simulator.GetAverageWait());
+    result.Add("waiting probability", simulator.GetWaitProbability());
+    result.Add("server idle probability", simulator.GetIdleProbability());
+    result.Add("average time in system", simulator.GetAverageTimeInSystem());
+    result.Add("average number in queue", simulator.GetAverageQueueLength());
+    result.Add("dWq/dmu", simulator.GetWaitDerivative());
+    result.Add("dW/dmu", simulator.GetTimeInSystemDerivative());
+    result.Add("dLq/dlambda", simulator.GetQueueLengthDerivative());
+  }
+
+  return result;
+}
+
+common::ScenarioKey single_channel_queue_simulation::GetScenarioKey(int n_customer,
+                                                                   EventModel& arrival_model,
+                                                                   EventModel& service_model) {
+  common::ScenarioKey key("hw2");
+  key.Add(kModelVersion);
+  key.Add(n_customer);
+  arrival_model.AddToKey(key);
+  service_model.AddToKey(key);
+  key.Add(kReplicationSeed);
+  return key;
+}
+
+// the batch runner links the simulator without this main
+#ifndef SIMULATION_NO_MAIN
+int main(int argc, char* argv[]) {
   std::vector<int> arrival_intervals {1, 2, 3, 4, 5, 6, 7, 8};
   std::vector<float> arrival_probs (8, 0.125);
   std::vector<int> service_times {1, 2, 3, 4, 5, 6};
@@ -212,9 +344,75 @@ int main() {
 
   EventModel arrival_model(3, arrival_intervals, arrival_probs);
   EventModel service_model(2, service_times, service_probs);
+  int n_replication = 0, n_shard = 0, n_worker = 0, n_what_if = 0;
+  std::string cache_dir;
+
+  // options come in pairs:
+  //   replications <n>: n independent runs in worker processes, with 95%
+  //     intervals over the runs instead of the logged table
+  //   shards <n>: pieces the replications are cut into, 4 per worker by default
+  //   workers <n>: worker processes, one per hardware thread by default
+  //   cache <dir>: reuse the replications of this scenario stored in dir
+  //     and store the new ones there
+  //   what_if <n>: keep a table of n customers and apply edits from stdin,
+  //     recomputing only the customers they change, see what_if.h
+  for(int i = 1; i + 1 < argc; i += 2) {
+    std::string option = argv[i], value = argv[i + 1];
+
+    if(option == "replications") {
+      n_replication = std::stoi(value);
+    }
+    else if(option == "shards") {
+      n_shard = std::stoi(value);
+    }
+    else if(option == "workers") {
+      n_worker = std::stoi(value);
+    }
+    else if(option == "cache") {
+      cache_dir = value;
+    }
+    else if(option == "what_if") {
+      n_what_if = std::stoi(value);
+    }
+  }
+
+  if(n_what_if) {
+    RunWhatIfSession(n_what_if, arrival_model, service_model);
+    return 0;
+  }
+
+  if(n_replication) {
+    common::ShardRunner runner(n_worker);
+    if(!n_shard) n_shard = 4 * runner.GetNWorker();
+    auto run = [&](int64_t first, int64_t count) {
+      return runner.Run(count, n_shard, [&](int64_t shard_first, int64_t shard_count) {
+        return RunReplications(n_customer, arrival_model, service_model, first + shard_first,
+                               shard_count);
+      });
+    };
+
+    common::PartialResult result;
+    int64_t n_cached = 0;
+    if(cache_dir.empty()) {
+      result = run(0, n_replication);
+    }
+    else {
+      common::ResultCache cache(cache_dir);
+      result = cache.Run(GetScenarioKey(n_customer, arrival_model, service_model), n_replication, run);
+      n_cached = cache.GetNCached();
+    }
+
+    std::cout << "REPLICATIONS (" << n_replication << " of " << n_customer << " customers, "
+              << n_shard << " shards on " << runner.GetNWorker() << " workers, "
+              << runner.GetNRerun() << " rerun, " << n_cached << " cached)" << std::endl
+              << result.GetReport();
+    return 0;
+  }
+
   Simulator simulator(n_customer, arrival_model, service_model);
 
   simulator.RunSimulation();
 
   return 0;
 }
+#endif // SIMULATION_NO_MAIN
@@ -5,6 +5,8 @@
 #include <sstream>
 #include <fstream>
 
+#include "../common/cache.h"
+
 namespace single_channel_queue_simulation {
 
   class Simulator;
@@ -14,6 +16,8 @@ namespace single_channel_queue_simulation {
     EventModel(int, std::vector<int>, std::vector<float>);
 
     int GetEvent();
+    float GetMean();
+    void AddToKey(common::ScenarioKey&);
 
   private:
     int n_decimal_, n_options_;
@@ -27,17 +31,21 @@ namespace single_channel_queue_simulation {
   class Customer {
   public:
     Customer(int);
-    Customer(int, int, Customer);
+    Customer(int, int, const Customer&);
 
   private:
     static int customer_id_;
     int inter_arrival_time_, arrival_time_,
       service_time_, time_service_begins_, waiting_time_in_queue_,
       time_service_ends_, time_customer_spends_in_system_, idle_time_of_server_;
+    // derivatives by the log of the mean service (mu) and interarrival
+    // (lambda) times, see the constructor
+    double d_waiting_time_mu_, d_waiting_time_lambda_, d_service_ends_mu_, d_service_ends_lambda_;
 
     friend Simulator;
   };
 
+  // log.txt is opened on the first Log
   class Logger {
   public:
     Logger();
@@ -60,15 +68,28 @@ namespace single_channel_queue_simulation {
     void UpdateHistory(Customer&);
     void LogTotals();
     void LogMetrics();
+    void SetLogging(bool);
+    float GetAverageWait(), GetWaitProbability(), GetIdleProbability(), GetAverageTimeInSystem();
+    float GetAverageQueueLength();
+    // IPA estimates from the same run: dWq/dmu and dW/dmu by the mean service
+    // time, dLq/dlambda by the mean interarrival time
+    float GetWaitDerivative(), GetTimeInSystemDerivative(), GetQueueLengthDerivative();
 
     static int n_wait_, clock_;
 
   private:
+    bool logging_;
     int n_customer_;
     EventModel arrival_model_;
     EventModel service_model_;
     Logger logger_;
     int total_it_, total_st_, total_wtq_, total_tcss_, total_its_;
+    double d_total_wtq_mu_, d_total_wtq_lambda_, d_clock_lambda_;
   };
+
+  // replications [first, first + count) of n_customer customers each, a
+  // shard of common::ShardRunner
+  common::PartialResult RunReplications(int, EventModel&, EventModel&, int64_t, int64_t);
+  common::ScenarioKey GetScenarioKey(int, EventModel&, EventModel&);
 }
 #endif // HW2_CHANNEL_QUEUE_H_
@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <sstream>
+
+#include "what_if.h"
+
+using namespace single_channel_queue_simulation;
+
+WhatIfSimulator::WhatIfSimulator() {
+  total_it_ = total_st_ = total_wtq_ = n_wait_ = 0;
+}
+
+uint16_t WhatIfSimulator::Narrow(int value) {
+  if(value < 0 || value > 65535) throw (value);
+  return value;
+}
+
+void WhatIfSimulator::Build(int n_customer, EventModel& arrival_model, EventModel& service_model) {
+  if(n_customer < 1) throw (n_customer);
+
+  interval_.assign(n_customer, 0);
+  service_.assign(n_customer, 0);
+  wait_.assign(n_customer, 0);
+  total_it_ = total_st_ = total_wtq_ = n_wait_ = 0;
+
+  service_[0] = Narrow(service_model.GetEvent());
+  total_st_ += service_[0];
+  for(int i = 1; i < n_customer; i++) {
+    service_[i] = Narrow(service_model.GetEvent());
+    interval_[i] = Narrow(arrival_model.GetEvent());
+    total_st_ += service_[i];
+    total_it_ += interval_[i];
+  }
+
+  // every wait starts at 0, so the recursion fills in the whole table
+  Propagate(1, n_customer - 1);
+}
+
+// recomputes waits from customer first on. customers up to last have changed
+// inputs and are always recomputed, after that the pass stops at the first
+// customer whose wait comes out as before
+long long WhatIfSimulator::Propagate(int first, int last) {
+  int n_customer = wait_.size();
+  long long n = 0;
+
+  for(int i = first; i < n_customer; i++) {
+    int wait = std::max(0, wait_[i - 1] + service_[i - 1] - interval_[i]);
+    n++;
+    if(wait == wait_[i] && i >= last) break;
+
+    total_wtq_ += wait - wait_[i];
+    n_wait_ += (wait > 0) - (wait_[i] > 0);
+    wait_[i] = wait;
+  }
+
+  return n;
+}
+
+long long WhatIfSimulator::SetServiceTime(int k, int service_time) {
+  if(k < 0 || k >= GetNCustomer()) throw (k);
+
+  uint16_t s = Narrow(service_time);
+  total_st_ += s - service_[k];
+  service_[k] = s;
+  return k + 1 < GetNCustomer() ? Propagate(k + 1, k + 1) : 0;
+}
+
+// the first customer arrives at 0 and has no interval
+long long WhatIfSimulator::SetArrivalInterval(int k, int interval) {
+  if(k < 1 || k >= GetNCustomer()) throw (k);
+
+  uint16_t a = Narrow(interval);
+  total_it_ += a - interval_[k];
+  interval_[k] = a;
+  return Propagate(k, k);
+}
+
+// new draws from service_model for the customers from k on
+long long WhatIfSimulator::ResampleServices(int k, EventModel& service_model) {
+  if(k < 0 || k >= GetNCustomer()) throw (k);
+
+  for(int i = k; i < GetNCustomer(); i++) {
+    uint16_t s = Narrow(service_model.GetEvent());
+    total_st_ += s - service_[i];
+    service_[i] = s;
+  }
+  return k + 1 < GetNCustomer() ? Propagate(k + 1, GetNCustomer() - 1) : 0;
+}
+
+long long WhatIfSimulator::ResampleArrivals(int k, EventModel& arrival_model) {
+  if(k < 1 || k >= GetNCustomer()) throw (k);
+
+  for(int i = k; i < GetNCustomer(); i++) {
+    uint16_t a = Narrow(arrival_model.GetEvent());
+    total_it_ += a - interval_[i];
+    interval_[i] = a;
+  }
+  return Propagate(k, GetNCustomer() - 1);
+}
+
+int WhatIfSimulator::GetNCustomer() {
+  return wait_.size();
+}
+
+int WhatIfSimulator::GetWait(int k) {
+  if(k < 0 || k >= GetNCustomer()) throw (k);
+  return wait_[k];
+}
+
+// the metrics of Simulator::LogMetrics. the last customer leaves at its
+// arrival (the sum of the intervals) plus its wait and service, and the
+// server was idle for whatever of that it was not serving
+std::string WhatIfSimulator::GetMetrics() {
+  int n_customer = GetNCustomer();
+  long long clock = total_it_ + wait_.back() + service_.back();
+  long long total_its = clock - total_st_, total_tcss = total_st_ + total_wtq_;
+
+  std::stringstream metrics;
+  metrics << "average waiting time: " << (float)total_wtq_ / n_customer << std::endl
+          << "waiting probability: " << (float)n_wait_ / n_customer << std::endl
+          << "server idle probability: " << (float)total_its / clock << std::endl
+          << "average service time: " << (float)total_st_ / n_customer << std::endl
+          << "average inter arrival time: " << (float)total_it_ / (n_customer - 1) << std::endl
+          << "average waiting time for queue people: " << (float)total_wtq_ / n_wait_ << std::endl
+          << "average time in system: " << (float)total_tcss / n_customer << std::endl
+    ;
+
+  return metrics.str();
+}
+
+std::vector<std::string> GetList(const std::string& list) {
+  std::vector<std::string> items;
+  std::stringstream ss(list);
+  std::string item;
+  while(std::getline(ss, item, ',')) items.push_back(item);
+  return items;
+}
+
+// a table given as comma separated values and probabilities. every value
+// must fit the 16 bits of a stored time, so a resample never stops halfway
+EventModel GetEventModel(const std::string& values, const std::string& probs) {
+  const int kNDecimal = 4;
+  std::vector<int> options;
+  std::vector<float> probabilities;
+  for(std::string& v : GetList(values)) options.push_back(std::stoi(v));
+  for(std::string& p : GetList(probs)) probabilities.push_back(std::stof(p));
+  if(options.empty() || options.size() != probabilities.size()) throw "BAD EVENT TABLE";
+  for(int option : options)
+    if(option < 0 || option > 65535) throw (option);
+
+  return EventModel(kNDecimal, options, probabilities);
+}
+
+void single_channel_queue_simulation::RunWhatIfSession(int n_customer, EventModel& arrival_model,
+                                                       EventModel& service_model) {
+  WhatIfSimulator simulator;
+  auto start = std::chrono::steady_clock::now();
+  simulator.Build(n_customer, arrival_model, service_model);
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  std::cout << "built " << n_customer << " customers in " << elapsed.count() << " s" << std::endl
+            << simulator.GetMetrics();
+
+  std::string line;
+  while(std::getline(std::cin, line)) {
+    std::stringstream command(line);
+    std::string name, values, probs;
+    int k = 0, time = 0;
+    command >> name >> k;
+    if(name.empty()) continue;
+
+    // a bad index or value is reported and the session goes on
+    try {
+      start = std::chrono::steady_clock::now();
+      long long n = -1;
+      if(name == "service" && command >> time) {
+        n = simulator.SetServiceTime(k, time);
+      }
+      else if(name == "interval" && command >> time) {
+        n = simulator.SetArrivalInterval(k, time);
+      }
+      else if(name == "services" && command >> values >> probs) {
+        EventModel model = GetEventModel(values, probs);
+        n = simulator.ResampleServices(k, model);
+      }
+      else if(name == "arrivals" && command >> values >> probs) {
+        EventModel model = GetEventModel(values, probs);
+        n = simulator.ResampleArrivals(k, model);
+      }
+      else if(name == "wait") {
+        int wait = simulator.GetWait(k);
+        std::cout << "wait of customer " << k << ": " << wait << std::endl;
+        continue;
+      }
+      else if(name == "metrics") {
+        std::cout << simulator.GetMetrics();
+        continue;
+      }
+      else {
+        std::cout << "unknown command: " << line << std::endl;
+        continue;
+      }
+      elapsed = std::chrono::steady_clock::now() - start;
+
+      std::cout << "recomputed " << n << " customers in " << elapsed.count() * 1000 << " ms" << std::endl;
+    }
+    catch(const char* error) {
+      std::cout << "error: " << error << std::endl;
+    }
+    catch(const std::exception& error) {
+      std::cout << "error: " << error.what() << std::endl;
+    }
+    catch(int value) {
+      std::cout << "error: bad value " << value << std::endl;
+    }
+  }
+}
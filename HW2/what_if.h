@@ -0,0 +1,60 @@
+#ifndef HW2_WHAT_IF_H_
+#define HW2_WHAT_IF_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "queue.h"
+
+namespace single_channel_queue_simulation {
+
+  // a retained customer table for what-if edits. a customer's wait depends
+  // on the one before only, through the Lindley recursion of Customer:
+  //   wait[i] = max(0, wait[i - 1] + service[i - 1] - interval[i])
+  // so an edit at k only touches the customers from k on, and once a
+  // recomputed wait past the edited range equals the old one every later
+  // customer is unchanged too (in particular when both versions empty the
+  // system). the totals of UpdateHistory are kept up to date by the
+  // difference of every recomputed customer; the server's idle time is the
+  // clock less the service times, so it needs no per customer value.
+  // intervals and service times are stored as 16 bit values and waits as 32
+  // bit ones, 8 bytes a customer.
+  class WhatIfSimulator {
+  public:
+    WhatIfSimulator();
+
+    // draws n_customer customers in the order RunSimulation does, so the
+    // totals match the ones Simulator logs for the same std::rand state
+    void Build(int, EventModel&, EventModel&);
+
+    // each edit returns the number of customers it recomputed
+    long long SetServiceTime(int, int);
+    long long SetArrivalInterval(int, int);
+    long long ResampleServices(int, EventModel&);
+    long long ResampleArrivals(int, EventModel&);
+
+    int GetNCustomer();
+    int GetWait(int);
+    std::string GetMetrics();
+
+  private:
+    long long Propagate(int, int);
+    uint16_t Narrow(int);
+
+    std::vector<uint16_t> interval_, service_;
+    std::vector<int32_t> wait_;
+    long long total_it_, total_st_, total_wtq_, n_wait_;
+  };
+
+  // builds n_customer customers and applies edits read from stdin, one per
+  // line, printing how many customers each one recomputed and how long it took:
+  //   service <k> <time>, interval <k> <time>: one customer's times
+  //   services <k> <v1,v2,...> <p1,p2,...>: new service table from k on
+  //   arrivals <k> <v1,v2,...> <p1,p2,...>: new interval table from k on
+  //   wait <k>: the wait of customer k
+  //   metrics: the metrics of the current table
+  void RunWhatIfSession(int, EventModel&, EventModel&);
+
+}
+#endif // HW2_WHAT_IF_H_
@@ -3,12 +3,19 @@
 #include <cmath>
 #include <sstream>
 #include <iomanip>
+#include <memory>
 
 #include "news_paper.h"
 
 using namespace news_paper;
 
 const int Simulator::kNDay = 200000000;
+const int Simulator::kNWarmUpDay = 1000;
+const uint32_t Simulator::kCheckpointMagic = 0x35574850; // "PHW5"
+const uint32_t Simulator::kCheckpointVersion = 2;
+const int kProgressMask = (1 << 16) - 1; // publish every 65536 days
+const uint64_t kReplicationSeed = 0x2545f4914f6cdd1dULL;
+const uint32_t kModelVersion = 1; // bump when a change alters the results of a scenario
 
 void Logger::SetLogFile(std::string fs) {
   log_file_ = std::ofstream(fs);
@@ -56,11 +63,21 @@ EventModel<T>::EventModel(int n_decimal, std::vector<T> options, std::vector<flo
 }
 
 template <class T>
-T EventModel<T>::GetEvent() {
-  int r = std::rand();
+T EventModel<T>::GetEvent(common::Random& random) {
   int range = std::pow(10, n_decimal_);
-  r = r % range;
+  return GetOption(random.Next() % range);
+}
+
+// maps a 32 bit uniform by its leading digits instead of the remainder, so
+// stratified uniforms give stratified events
+template <class T>
+T EventModel<T>::GetEvent(uint32_t u) {
+  uint64_t range = std::pow(10, n_decimal_);
+  return GetOption(u * range >> 32);
+}
 
+template <class T>
+T EventModel<T>::GetOption(int r) {
   if(r == 0) return options_.back();
 
   for(int i = 0; i < n_options_; i++) {
@@ -70,15 +87,61 @@ T EventModel<T>::GetEvent() {
   throw (r);
 }
 
+// the distribution GetEvent actually samples: every r in [0, 10^n_decimal) is
+// equally likely, so truncated cumulative sums show up here
+template <class T>
+common::Distribution<T> EventModel<T>::GetDistribution() {
+  common::Distribution<T> distribution;
+  int range = std::pow(10, n_decimal_);
+
+  for(int r = 0; r < range; r++)
+    distribution.Add(GetOption(r), 1.0 / range);
+
+  return distribution;
+}
+
+// largest gap between a declared probability and the sampled one
+template <class T>
+float EventModel<T>::GetQuantizationError() {
+  common::Distribution<T> distribution = GetDistribution();
+  float error = 0;
+
+  for(int i = 0; i < n_options_; i++) {
+    auto point = distribution.GetPoints().find(options_[i]);
+    float sampled = point == distribution.GetPoints().end() ? 0 : point->second;
+    error = std::max(error, std::abs(sampled - probs_[i]));
+  }
+
+  return error;
+}
+
+// the table as drawn: decimals, options and probabilities
+template <class T>
+void EventModel<T>::AddToKey(common::ScenarioKey& key) {
+  key.Add(n_decimal_);
+  key.Add(options_);
+  key.Add(probs_);
+}
+
+template class news_paper::EventModel<DayType>;
+template class news_paper::EventModel<int>;
+
 Simulator::Simulator(EventModel<DayType>& day_model, EventModel<int>& good_model,
                      EventModel<int>& fair_model, EventModel<int>& poor_model)
   : day_model_(day_model), good_model_(good_model),
     fair_model_(fair_model), poor_model_(poor_model) {
   total_revenue_ = total_lost_profit_ = total_salvage_ = total_cost_ = total_profit_ = n_news_paper_ = 0;
+  checkpoint_interval_ = day_ = 0;
+  resumed_ = false;
+  logging_ = true;
+  progress_days_ = progress_profit_ = progress_n_np_ = nullptr;
+  profiler_ = nullptr;
 }
 
 void Simulator::ResetTotals() {
   total_revenue_ = total_lost_profit_ = total_salvage_ = total_cost_ = total_profit_ = 0;
+  day_ = 0;
+  resumed_ = false;
 }
 
 bool Logger::HasLogFile() {
@@ -93,11 +156,19 @@ void Simulator::SetNNewsPaper(int n) {
   n_news_paper_ = n;
 
   if(logger_.HasLogFile()) logger_.CloseLogFile();
+  if(!logging_) return;
+
   std::stringstream fs;
   fs << "log_" << n << ".txt";
   logger_.SetLogFile(fs.str());
 }
 
+// without logging no log_<n>.txt is opened and Log writes nowhere, call
+// before SetNNewsPaper
+void Simulator::SetLogging(bool logging) {
+  logging_ = logging;
+}
+
 Day::Day(int id, int demand, int n_np, DayType dt) {
   id_ = id;
   demand_ = demand;
@@ -110,13 +181,13 @@ Day::Day(int id, int demand, int n_np, DayType dt) {
 int Simulator::GetDemand(DayType dt) {
   switch(dt) {
   case DayType::kGood:
-    return good_model_.GetEvent();
+    return good_model_.GetEvent(random_);
     break;
   case DayType::kFair:
-    return fair_model_.GetEvent();
+    return fair_model_.GetEvent(random_);
     break;
   case DayType::kPoor:
-    return poor_model_.GetEvent();
+    return poor_model_.GetEvent(random_);
     break;
   default:
     throw (dt);
@@ -132,13 +203,80 @@ void Day::SetFields() {
 }
 
 void Simulator::StepSimulate(int it, Day& day) {
-  DayType dt = day_model_.GetEvent();
+  DayType dt = day_model_.GetEvent(random_);
   int demand = GetDemand(dt);
 
   day = Day(it, demand, n_news_paper_, dt);
   day.SetFields();
 }
 
+// randomized quasi monte carlo: every replication runs n_day days on a newly
+// scrambled Sobol net, day type from dimension 0 and demand from dimension 1.
+// returns the profit per day of each replication, so the spread between them
+// is an honest error estimate. n_day should be a power of two.
+common::Summary Simulator::RunQuasiSimulation(int n_day, int n_replication) {
+  common::Summary profits;
+  EventModel<int>* demand_models[] = {&good_model_, &fair_model_, &poor_model_};
+
+  for(int r = 0; r < n_replication; r++) {
+    common::Sobol sobol(r);
+    double profit = 0;
+
+    for(int i = 0; i < n_day; i++) {
+      DayType dt = day_model_.GetEvent(sobol.Get(i, 0));
+      Day day(i, demand_models[dt]->GetEvent(sobol.Get(i, 1)), n_news_paper_, dt);
+      day.SetFields();
+      profit += day.GetProfit();
+    }
+
+    profits.Add(profit / n_day);
+  }
+
+  std::stringstream log;
+  log << "quasi monte carlo, " << n_replication << " replications of " << n_day << " days" << std::endl
+      << "profit per day: " << profits.GetMean() << " +- " << profits.GetHalfWidth() << " (95%)" << std::endl;
+  logger_.Log(log.str());
+
+  return profits;
+}
+
+// replications [first, first + count) of n_day pseudo random days, a shard of
+// common::ShardRunner. replication r runs on stream r of one seed, so it
+// draws the same days whichever worker runs it
+common::PartialResult Simulator::RunReplications(int n_day, int64_t first, int64_t count) {
+  common::PartialResult result;
+  std::string name = "profit per day, " + std::to_string(n_news_paper_) + " newspapers";
+  Day day(0, 0, 0, DayType::kGood);
+
+  for(int64_t r = first; r < first + count; r++) {
+    random_.Seed(kReplicationSeed, r);
+    double profit = 0;
+
+    for(int i = 0; i < n_day; i++) {
+      StepSimulate(i, day);
+      profit += day.GetProfit();
+    }
+
+    result.Add(name, profit / n_day);
+  }
+
+  return result;
+}
+
+// everything RunReplications(n_day, ...) depends on
+common::ScenarioKey Simulator::GetScenarioKey(int n_day) {
+  common::ScenarioKey key("hw5");
+  key.Add(kModelVersion);
+  key.Add(n_day);
+  key.Add(n_news_paper_);
+  day_model_.AddToKey(key);
+  good_model_.AddToKey(key);
+  fair_model_.AddToKey(key);
+  poor_model_.AddToKey(key);
+  key.Add(kReplicationSeed);
+  return key;
+}
+
 void Simulator::InitializeLogTable() {
   std::stringstream heads;
   heads << "D"
@@ -251,27 +389,189 @@ void Simulator::RunSimulation() {
   if(kNDay == 0) return;
   Day day(0, 0, 0, DayType::kGood);
 
-  for(int i = 0; i < 1000; i++) {
-    StepSimulate(i, day);
+  // a resumed run is already past its warm up
+  if(!resumed_) {
+    if(profiler_) profiler_->Begin("warm up");
+    for(int i = 0; i < kNWarmUpDay; i++) {
+      StepSimulate(i, day);
+    }
+    if(profiler_) profiler_->AddEvents("warm up", kNWarmUpDay);
   }
 
   InitializeLogTable();
 
-  for(int i = 0; i < kNDay; i++) {
-    StepSimulate(i, day);
+  if(profiler_) profiler_->Begin("main loop");
+  int first_day = day_;
+  while(day_ < kNDay) {
+    StepSimulate(day_, day);
     UpdateTotals(day);
     //LogDay(day);
+    day_++;
+
+    if(checkpoint_interval_ && day_ % checkpoint_interval_ == 0 && day_ < kNDay)
+      WriteCheckpoint();
+
+    if(progress_days_ && (day_ & kProgressMask) == 0)
+      PublishProgress();
+  }
+
+  if(progress_days_) PublishProgress();
+
+  if(profiler_) {
+    profiler_->AddEvents("main loop", day_ - first_day);
+    profiler_->Begin("totals and log");
+  }
+
+  // the finished checkpoint also carries the generator into the next run
+  if(checkpoint_interval_) {
+    WriteCheckpoint();
+    checkpoint_writer_.Flush();
   }
 
   LogTotals();
+
+  if(profiler_) profiler_->End();
 }
 
-float Simulator::GetTotalProfit() {
+// phases of RunSimulation, days are the events
+void Simulator::SetProfiler(common::PhaseProfiler& profiler) {
+  profiler_ = &profiler;
+}
+
+void Simulator::SetProgress(common::ProgressRegistry& registry) {
+  progress_days_ = registry.AddCounter("hw5.days");
+  progress_profit_ = registry.AddGauge("hw5.profit_per_day");
+  progress_n_np_ = registry.AddGauge("hw5.n_news_paper");
+}
+
+void Simulator::PublishProgress() {
+  progress_days_->SetCount(day_);
+  progress_n_np_->Set(n_news_paper_);
+  if(day_) progress_profit_->Set(total_profit_ / day_);
+}
+
+void Simulator::SetCheckpoint(std::string prefix, int interval) {
+  checkpoint_prefix_ = prefix;
+  checkpoint_interval_ = interval;
+}
+
+void Simulator::WriteCheckpoint() {
+  std::stringstream path;
+  path << checkpoint_prefix_ << "_" << n_news_paper_ << ".bin";
+  checkpoint_writer_.Submit(path.str(), Serialize());
+}
+
+std::string Simulator::Serialize() {
+  common::CheckpointBuffer buffer;
+  buffer.Put(kNDay);
+  buffer.Put(n_news_paper_);
+  buffer.Put(day_);
+  buffer.PutRandom(random_);
+  buffer.Put(total_revenue_);
+  buffer.Put(total_lost_profit_);
+  buffer.Put(total_salvage_);
+  buffer.Put(total_cost_);
+  buffer.Put(total_profit_);
+
+  return buffer.Finish(kCheckpointMagic, kCheckpointVersion);
+}
+
+// restores a state written by Serialize for the same day count and newspaper count
+bool Simulator::Deserialize(const std::string& bytes) {
+  common::CheckpointReader reader;
+  if(!reader.Open(bytes, kCheckpointMagic, kCheckpointVersion)) return false;
+
+  int n_day, n_news_paper;
+  if(!reader.Get(n_day) || !reader.Get(n_news_paper)) return false;
+  if(n_day != kNDay || n_news_paper != n_news_paper_) return false;
+
+  bool ok = reader.Get(day_)
+    && reader.GetRandom(random_)
+    && reader.Get(total_revenue_)
+    && reader.Get(total_lost_profit_)
+    && reader.Get(total_salvage_)
+    && reader.Get(total_cost_)
+    && reader.Get(total_profit_)
+    && reader.IsDone();
+  if(!ok) throw "CORRUPT CHECKPOINT";
+
+  return true;
+}
+
+bool Simulator::Resume() {
+  std::stringstream path;
+  path << checkpoint_prefix_ << "_" << n_news_paper_ << ".bin";
+
+  std::string bytes;
+  if(!common::ReadCheckpointFile(path.str(), bytes)) return false;
+
+  resumed_ = Deserialize(bytes);
+  return resumed_;
+}
+
+double Simulator::GetTotalProfit() {
   return total_profit_;
 }
 
-int main() {
+// mean and variance of the daily profit, by enumerating day types and their
+// demand tables. false when the tables are too large, then simulate instead.
+bool Simulator::GetExactProfit(double& mean, double& variance) {
+  common::Distribution<DayType> days = day_model_.GetDistribution();
+  common::Distribution<int> demands[] = {good_model_.GetDistribution(),
+    fair_model_.GetDistribution(), poor_model_.GetDistribution()};
+
+  size_t support = 0;
+  for(auto& d : demands) support += d.GetSize();
+  if(days.GetSize() * support > common::kMaxExactSupport) return false;
+
+  common::Distribution<float> profits;
+  int n_np = n_news_paper_;
+  for(const auto& day : days.GetPoints()) {
+    profits.AddMixture(demands[day.first].Map([n_np, &day](int demand) {
+      Day d(0, demand, n_np, day.first);
+      d.SetFields();
+      return d.GetProfit();
+    }), day.second);
+  }
+
+  mean = profits.GetMean();
+  variance = profits.GetVariance();
+  return true;
+}
+
+// compares the simulated profit with the exact expectation, a large z score
+// means the simulator does not sample the model it was given
+void Simulator::LogAccuracy() {
+  double mean, variance;
+  std::stringstream accuracy;
+  accuracy << "newspapers: " << n_news_paper_ << std::endl;
+
+  if(!GetExactProfit(mean, variance)) {
+    accuracy << "model too large for exact evaluation" << std::endl;
+  }
+  else {
+    double simulated = total_profit_ / kNDay;
+    accuracy << "simulated profit per day: " << simulated << std::endl
+             << "exact profit per day: " << mean << std::endl
+             << "z score: " << common::GetZScore(simulated, mean, variance, kNDay) << std::endl;
+  }
+
+  float quantization = std::max(day_model_.GetQuantizationError(),
+    std::max(good_model_.GetQuantizationError(),
+             std::max(fair_model_.GetQuantizationError(), poor_model_.GetQuantizationError())));
+  accuracy << "largest table quantization error: " << quantization << std::endl;
+
+  std::string accuracy_string = accuracy.str();
+  logger_.Log(accuracy_string);
+  std::cout << accuracy_string;
+}
+
+// the batch runner links the simulator without this main
+#ifndef SIMULATION_NO_MAIN
+int main(int argc, char* argv[]) {
   int n_runs = 2;
+  const int kCheckpointInterval = 20000000;
+  const int kProgressIntervalMs = 1000;
   std::vector<int> n_np = {60, 70};
   std::vector<int> demands = {40, 50, 60, 70, 80, 90, 100};
   std::vector<float> good_demands_prob = {0.03, 0.05, 0.15, 0.2, 0.35, 0.15, 0.07};
@@ -288,12 +588,125 @@ int main() {
     poor_model(2, demands, poor_demands_prob);
   Simulator simulator(day_model, good_model, fair_model, poor_model);
 
-  std::vector<float> profits;
+  common::ProgressRegistry progress;
+  std::unique_ptr<common::ProgressSampler> sampler;
+  common::PhaseProfiler profiler;
+  bool checkpoint = false, profile = false;
+  std::string mode = "simulate", cache_dir, progress_target;
+  int qmc_day = 1 << 16, n_replication = 16, n_shard = 0, n_worker = 0;
+
+  // options come in pairs:
+  //   checkpoint <prefix>: checkpoint every run, resume the ones on disk
+  //   progress <target>: publish progress to stderr (-), unix:<socket> or a
+  //     file, not with mode shard
+  //   mode <simulate|exact|check|qmc|shard>: exact skips simulating when the
+  //     tables are small enough, check simulates and compares with the exact
+  //     profit, qmc runs replications of scrambled Sobol nets, shard runs
+  //     pseudo random replications in worker processes
+  //   qmc_days <n>, replications <n>: size of the qmc and shard runs
+  //   shards <n>: pieces the shard replications are cut into, 4 per worker by default
+  //   workers <n>: worker processes, one per hardware thread by default
+  //   cache <dir>: reuse the shard replications of a scenario stored in dir
+  //     and store the new ones there
+  //   profile on: hardware counters of each phase, wall clock where not allowed
+  for(int i = 1; i + 1 < argc; i += 2) {
+    std::string option = argv[i], value = argv[i + 1];
+
+    if(option == "checkpoint") {
+      checkpoint = true;
+      simulator.SetCheckpoint(value, kCheckpointInterval);
+    }
+    else if(option == "progress") {
+      progress_target = value;
+    }
+    else if(option == "mode") {
+      mode = value;
+    }
+    else if(option == "qmc_days") {
+      qmc_day = std::stoi(value);
+    }
+    else if(option == "replications") {
+      n_replication = std::stoi(value);
+    }
+    else if(option == "shards") {
+      n_shard = std::stoi(value);
+    }
+    else if(option == "workers") {
+      n_worker = std::stoi(value);
+    }
+    else if(option == "cache") {
+      cache_dir = value;
+    }
+    else if(option == "profile") {
+      profile = true;
+      simulator.SetProfiler(profiler);
+    }
+  }
+
+  if(qmc_day < 1 || n_replication < 1) throw "NO REPLICATIONS";
+  // shard forks its workers, which must not inherit a sampler thread, and
+  // the workers' progress would not reach it anyway
+  if(mode == "shard" && !progress_target.empty()) throw "NO PROGRESS WITH MODE SHARD";
+
+  if(!progress_target.empty()) {
+    simulator.SetProgress(progress);
+    sampler.reset(new common::ProgressSampler(progress, progress_target, kProgressIntervalMs));
+    sampler->Start();
+  }
+
+  std::vector<double> profits;
 
   for(int i = 0; i < n_runs; i++) {
     simulator.ResetTotals();
     simulator.SetNNewsPaper(n_np[i]);
+
+    double mean, variance;
+    if(mode == "exact" && simulator.GetExactProfit(mean, variance)) {
+      std::cout << n_np[i] << " newspapers, exact profit per day: " << mean << std::endl;
+      profits.push_back(mean);
+      continue;
+    }
+
+    if(mode == "qmc") {
+      common::Summary quasi = simulator.RunQuasiSimulation(qmc_day, n_replication);
+      std::cout << n_np[i] << " newspapers, qmc profit per day: " << quasi.GetMean()
+                << " +- " << quasi.GetHalfWidth() << std::endl;
+      profits.push_back(quasi.GetMean());
+      continue;
+    }
+
+    if(mode == "shard") {
+      common::ShardRunner runner(n_worker);
+      int n = n_shard ? n_shard : 4 * runner.GetNWorker();
+      auto run = [&](int64_t first, int64_t count) {
+        return runner.Run(count, n, [&](int64_t shard_first, int64_t shard_count) {
+          return simulator.RunReplications(qmc_day, first + shard_first, shard_count);
+        });
+      };
+
+      common::PartialResult result;
+      int64_t n_cached = 0;
+      if(cache_dir.empty()) {
+        result = run(0, n_replication);
+      }
+      else {
+        common::ResultCache cache(cache_dir);
+        result = cache.Run(simulator.GetScenarioKey(qmc_day), n_replication, run);
+        n_cached = cache.GetNCached();
+      }
+
+      const common::Summary& profit = result.GetSummaries().begin()->second;
+      std::cout << n_np[i] << " newspapers, profit per day over " << profit.GetCount() << " replications: "
+                << profit.GetMean() << " +- " << profit.GetHalfWidth() << " (" << runner.GetNRerun()
+                << " shards rerun, " << n_cached << " cached)" << std::endl;
+      profits.push_back(profit.GetMean());
+      continue;
+    }
+
+    if(checkpoint && simulator.Resume())
+      std::cout << "resumed run " << n_np[i] << std::endl;
     simulator.RunSimulation();
+    if(mode == "check") simulator.LogAccuracy();
     profits.push_back(simulator.GetTotalProfit());
   }
 
@@ -304,8 +717,9 @@ int main() {
   }
 
   std::cout << "Best performance was for: " << n_np[max_ind] << std::endl;
+  if(profile) std::cout << profiler.GetReport();
 
 
   return 0;
 }
-
+#endif // SIMULATION_NO_MAIN
@@ -5,6 +5,15 @@
 #include <sstream>
 #include <fstream>
 
+#include "../common/random.h"
+#include "../common/checkpoint.h"
+#include "../common/progress.h"
+#include "../common/perf.h"
+#include "../common/exact.h"
+#include "../common/sobol.h"
+#include "../common/statistics.h"
+#include "../common/cache.h"
+
 namespace news_paper {
   enum DayType {
     kGood = 0,
@@ -18,7 +27,11 @@ namespace news_paper {
     EventModel();
     EventModel(int, std::vector<T>, std::vector<float>);
 
-    T GetEvent();
+    T GetEvent(common::Random&);
+    T GetEvent(uint32_t);
+    common::Distribution<T> GetDistribution();
+    float GetQuantizationError();
+    void AddToKey(common::ScenarioKey&);
 
   private:
     int n_decimal_, n_options_;
@@ -28,6 +41,7 @@ namespace news_paper {
 
     void SetCumProb();
     void SetCumSum();
+    T GetOption(int);
   }; // class EventModel
 
   class Day {
@@ -65,23 +79,45 @@ namespace news_paper {
 
     void RunSimulation();
     void StepSimulate(int, Day&);
+    common::Summary RunQuasiSimulation(int, int);
+    common::PartialResult RunReplications(int, int64_t, int64_t);
+    common::ScenarioKey GetScenarioKey(int);
     void SetDemandModel(int, std::vector<int>, std::vector<float>);
     void SetNNewsPaper(int);
+    void SetLogging(bool);
     void UpdateTotals(Day&);
     void ResetTotals();
     int GetDemand(DayType);
     void LogDay(Day&);
     void LogTotals();
     void InitializeLogTable();
-    float GetTotalProfit();
+    double GetTotalProfit();
+    bool GetExactProfit(double&, double&);
+    void LogAccuracy();
+    void SetCheckpoint(std::string, int);
+    bool Resume();
+    std::string Serialize();
+    bool Deserialize(const std::string&);
+    void WriteCheckpoint();
+    void SetProgress(common::ProgressRegistry&);
+    void SetProfiler(common::PhaseProfiler&);
+    void PublishProgress();
 
   private:
-    static const int kNDay;
+    static const int kNDay, kNWarmUpDay;
+    static const uint32_t kCheckpointMagic, kCheckpointVersion;
     Logger logger_;
+    common::Random random_;
+    common::CheckpointWriter checkpoint_writer_;
+    std::string checkpoint_prefix_;
+    int checkpoint_interval_, day_;
+    bool resumed_, logging_;
+    common::ProgressValue *progress_days_, *progress_profit_, *progress_n_np_;
+    common::PhaseProfiler* profiler_;
     int n_news_paper_;
     EventModel<DayType> day_model_;
     EventModel<int> good_model_, fair_model_, poor_model_;
-    float total_revenue_, total_lost_profit_, total_salvage_, total_cost_, total_profit_;
+    double total_revenue_, total_lost_profit_, total_salvage_, total_cost_, total_profit_;
   }; // class Simulator
 
 } // namespace news_paper
@@ -0,0 +1,196 @@
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <sstream>
+
+#include "fleet.h"
+
+using namespace milling;
+
+template <class Policy>
+FleetSimulator<Policy>::FleetSimulator(int n_machine, int n_component, EventModel<int>& life_model,
+                                       EventModel<int>& delay_model, MaintenanceCosts costs, Policy policy)
+  : n_machine_(n_machine), n_component_(n_component), life_model_(life_model),
+    delay_model_(delay_model), costs_(costs), policy_(policy) {
+  clock_ = horizon_ = 0;
+  install_time_.resize((size_t)n_machine_ * n_component_, 0);
+  generation_.resize((size_t)n_machine_ * n_component_, 0);
+  result_ = FleetResult();
+}
+
+template <class Policy>
+int FleetSimulator<Policy>::GetNMachine() {
+  return n_machine_;
+}
+
+template <class Policy>
+int FleetSimulator<Policy>::GetNComponent() {
+  return n_component_;
+}
+
+template <class Policy>
+double FleetSimulator<Policy>::GetClock() {
+  return clock_;
+}
+
+template <class Policy>
+void FleetSimulator<Policy>::Push(FleetEvent event) {
+  events_.push_back(event);
+  std::push_heap(events_.begin(), events_.end(), std::greater<FleetEvent>());
+}
+
+// draws the life of a new part and queues whichever comes first, its failure
+// or the replacement the policy plans at a fixed age
+template <class Policy>
+void FleetSimulator<Policy>::Install(int machine, int component) {
+  size_t i = (size_t)machine * n_component_ + component;
+  generation_[i]++;
+  install_time_[i] = clock_;
+
+  double life = life_model_.GetEvent(random_);
+  double planned_age = policy_.GetPlannedAge();
+
+  if(life <= planned_age) Push({clock_ + life, machine, component, generation_[i], false});
+  else Push({clock_ + planned_age, machine, component, generation_[i], true});
+}
+
+// a machine wide planned event, e.g. a block replacement
+template <class Policy>
+void FleetSimulator<Policy>::Schedule(double time, int machine) {
+  Push({time, machine, -1, 0, true});
+}
+
+template <class Policy>
+void FleetSimulator<Policy>::Charge(int n_replaced, bool planned, bool group) {
+  double repair = group ? costs_.group_repair_minutes : costs_.single_repair_minutes;
+  double delay = planned ? 0 : delay_model_.GetEvent(random_);
+
+  result_.n_replaced += n_replaced;
+  result_.cost_components += n_replaced * costs_.component;
+  result_.cost_delay += delay * costs_.downtime_per_minute;
+  result_.cost_downtime += repair * costs_.downtime_per_minute;
+  result_.cost_repair += repair / 60 * costs_.repairer_per_hour;
+}
+
+template <class Policy>
+void FleetSimulator<Policy>::Replace(int machine, int component, bool planned) {
+  Charge(1, planned, false);
+  Install(machine, component);
+}
+
+template <class Policy>
+void FleetSimulator<Policy>::ReplaceAll(int machine, bool planned) {
+  Charge(n_component_, planned, true);
+
+  for(int c = 0; c < n_component_; c++)
+    Install(machine, c);
+}
+
+template <class Policy>
+void FleetSimulator<Policy>::RunSimulation(double horizon) {
+  horizon_ = horizon;
+  clock_ = 0;
+  result_ = FleetResult();
+  events_.clear();
+  events_.reserve((size_t)n_machine_ * n_component_ * 2);
+
+  for(int m = 0; m < n_machine_; m++)
+    for(int c = 0; c < n_component_; c++)
+      Install(m, c);
+
+  policy_.OnStart(*this);
+
+  while(!events_.empty() && events_.front().time <= horizon_) {
+    FleetEvent event = events_.front();
+    std::pop_heap(events_.begin(), events_.end(), std::greater<FleetEvent>());
+    events_.pop_back();
+
+    // the part was replaced since this event was queued
+    if(event.component >= 0 &&
+       event.generation != generation_[(size_t)event.machine * n_component_ + event.component])
+      continue;
+
+    clock_ = event.time;
+    result_.n_event++;
+
+    if(event.planned) {
+      result_.n_planned++;
+      policy_.OnPlanned(*this, event.machine, event.component);
+    }
+    else {
+      result_.n_failure++;
+      policy_.OnFailure(*this, event.machine, event.component);
+    }
+  }
+
+  clock_ = horizon_;
+}
+
+template <class Policy>
+FleetResult FleetSimulator<Policy>::GetResult() {
+  FleetResult result = result_;
+  result.component_hours = horizon_ * n_machine_ * n_component_;
+  result.total_cost = result.cost_components + result.cost_delay
+    + result.cost_downtime + result.cost_repair;
+  result.cost_per_10k_hour = result.total_cost / (result.component_hours / 10000);
+  return result;
+}
+
+template class milling::FleetSimulator<OnDemandPolicy>;
+template class milling::FleetSimulator<BroadcastPolicy>;
+template class milling::FleetSimulator<AgeReplacementPolicy>;
+template class milling::FleetSimulator<BlockReplacementPolicy>;
+template class milling::FleetSimulator<ThresholdPolicy>;
+
+template <class Policy>
+FleetResult RunFleet(Policy policy, int n_machine, int n_component, double hours,
+                     EventModel<int>& life_model, EventModel<int>& delay_model, MaintenanceCosts costs) {
+  FleetSimulator<Policy> simulator(n_machine, n_component, life_model, delay_model, costs, policy);
+  simulator.RunSimulation(hours);
+  return simulator.GetResult();
+}
+
+FleetResult milling::RunFleetSimulation(std::string policy, double parameter, int n_machine,
+                                        int n_component, double hours, EventModel<int>& life_model,
+                                        EventModel<int>& delay_model, MaintenanceCosts costs) {
+  if(n_machine < 1 || n_component < 1 || !(hours > 0)) throw "BAD FLEET SIZE";
+  // a planned replacement at an age or interval of 0 would be due again at
+  // once, and the clock would never move
+  if((policy == "age" || policy == "block") && !(parameter > 0)) throw "BAD FLEET PARAMETER";
+
+  if(policy == "on_demand")
+    return RunFleet(OnDemandPolicy(), n_machine, n_component, hours, life_model, delay_model, costs);
+  if(policy == "broadcast")
+    return RunFleet(BroadcastPolicy(), n_machine, n_component, hours, life_model, delay_model, costs);
+  if(policy == "age")
+    return RunFleet(AgeReplacementPolicy(parameter), n_machine, n_component, hours,
+                    life_model, delay_model, costs);
+  if(policy == "block")
+    return RunFleet(BlockReplacementPolicy(parameter), n_machine, n_component, hours,
+                    life_model, delay_model, costs);
+  if(policy == "threshold")
+    return RunFleet(ThresholdPolicy(parameter), n_machine, n_component, hours,
+                    life_model, delay_model, costs);
+
+  throw "UNKNOWN POLICY";
+}
+
+void milling::LogFleetResult(std::string title, FleetResult& result, double seconds) {
+  std::stringstream metrics;
+  metrics << title << std::endl
+          << "Events: " << result.n_event << std::endl
+          << "Failures: " << result.n_failure << std::endl
+          << "Planned replacements: " << result.n_planned << std::endl
+          << "Replaced parts: " << result.n_replaced << std::endl
+          << "Cost of parts: " << result.cost_components << std::endl
+          << "Cost of delay time: " << result.cost_delay << std::endl
+          << "Cost of downtime during repair: " << result.cost_downtime << std::endl
+          << "Cost of repair person: " << result.cost_repair << std::endl
+          << "Total cost: " << result.total_cost << std::endl
+          << "Total life of parts: " << result.component_hours << std::endl
+          << "Total cost per 10k hour: " << result.cost_per_10k_hour << std::endl
+          << "Events per second: " << result.n_event / seconds << std::endl
+    ;
+
+  std::cout << metrics.str() << std::endl;
+}
@@ -0,0 +1,170 @@
+#ifndef MILLING_FLEET_H_
+#define MILLING_FLEET_H_
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "milling.h"
+#include "../common/random.h"
+
+namespace milling {
+
+  // prices of a replacement. lives are in hours, delays and repairs in minutes
+  struct MaintenanceCosts {
+    double component = 32;
+    double downtime_per_minute = 10;
+    double repairer_per_hour = 30;
+    double single_repair_minutes = 20;
+    double group_repair_minutes = 40;
+  }; // struct MaintenanceCosts
+
+  struct FleetResult {
+    long long n_event, n_failure, n_planned, n_replaced;
+    double component_hours, cost_components, cost_delay, cost_downtime, cost_repair,
+      total_cost, cost_per_10k_hour;
+  }; // struct FleetResult
+
+  // a pending failure or planned replacement. component is -1 for events that
+  // concern the whole machine, generation drops events of replaced components.
+  struct FleetEvent {
+    double time;
+    int machine, component;
+    uint32_t generation;
+    bool planned;
+
+    bool operator>(const FleetEvent& other) const {
+      return time > other.time;
+    }
+  }; // struct FleetEvent
+
+  // event driven maintenance of n_machine machines with n_component parts
+  // each. a part's life is drawn only when it is installed and the engine
+  // keeps a heap with one pending event per part, so a step costs O(log n).
+  // Policy decides what to replace through OnFailure, OnPlanned and OnStart.
+  template <class Policy>
+  class FleetSimulator {
+  public:
+    FleetSimulator(int, int, EventModel<int>&, EventModel<int>&, MaintenanceCosts, Policy);
+
+    void RunSimulation(double);
+    void Replace(int, int, bool);
+    void ReplaceAll(int, bool);
+    void Schedule(double, int);
+    void Install(int, int);
+    int GetNMachine(), GetNComponent();
+    double GetClock();
+    FleetResult GetResult();
+
+  private:
+    void Push(FleetEvent);
+    void Charge(int, bool, bool);
+
+    int n_machine_, n_component_;
+    EventModel<int> life_model_, delay_model_;
+    MaintenanceCosts costs_;
+    Policy policy_;
+    common::Random random_;
+    double clock_, horizon_;
+    std::vector<double> install_time_;
+    std::vector<uint32_t> generation_;
+    std::vector<FleetEvent> events_;
+    FleetResult result_;
+  }; // class FleetSimulator
+
+  // replace a part when it fails
+  class OnDemandPolicy {
+  public:
+    double GetPlannedAge() { return std::numeric_limits<double>::infinity(); }
+    template <class S> void OnStart(S&) {}
+    template <class S> void OnFailure(S& s, int m, int c) { s.Replace(m, c, false); }
+    template <class S> void OnPlanned(S&, int, int) {}
+  }; // class OnDemandPolicy
+
+  // replace every part of a machine when one of them fails
+  class BroadcastPolicy {
+  public:
+    double GetPlannedAge() { return std::numeric_limits<double>::infinity(); }
+    template <class S> void OnStart(S&) {}
+    template <class S> void OnFailure(S& s, int m, int) { s.ReplaceAll(m, false); }
+    template <class S> void OnPlanned(S&, int, int) {}
+  }; // class BroadcastPolicy
+
+  // replace a part when it fails or reaches age_ hours, whichever is first
+  class AgeReplacementPolicy {
+  public:
+    AgeReplacementPolicy(double age) : age_(age) {}
+
+    double GetPlannedAge() { return age_; }
+    template <class S> void OnStart(S&) {}
+    template <class S> void OnFailure(S& s, int m, int c) { s.Replace(m, c, false); }
+    template <class S> void OnPlanned(S& s, int m, int c) { s.Replace(m, c, true); }
+
+  private:
+    double age_;
+  }; // class AgeReplacementPolicy
+
+  // replace every part of a machine each interval_ hours, and single parts
+  // when they fail in between
+  class BlockReplacementPolicy {
+  public:
+    BlockReplacementPolicy(double interval) : interval_(interval) {}
+
+    double GetPlannedAge() { return std::numeric_limits<double>::infinity(); }
+
+    template <class S> void OnStart(S& s) {
+      for(int m = 0; m < s.GetNMachine(); m++) s.Schedule(interval_, m);
+    }
+
+    template <class S> void OnFailure(S& s, int m, int c) { s.Replace(m, c, false); }
+
+    template <class S> void OnPlanned(S& s, int m, int) {
+      s.ReplaceAll(m, true);
+      s.Schedule(s.GetClock() + interval_, m);
+    }
+
+  private:
+    double interval_;
+  }; // class BlockReplacementPolicy
+
+  // on a failure replace every part of the machine when its last group
+  // replacement is at least threshold_ hours ago, otherwise only the failed
+  // part. threshold 0 is broadcast and an infinite threshold on demand.
+  class ThresholdPolicy {
+  public:
+    ThresholdPolicy(double threshold) : threshold_(threshold) {}
+
+    double GetPlannedAge() { return std::numeric_limits<double>::infinity(); }
+
+    template <class S> void OnStart(S& s) {
+      group_time_.assign(s.GetNMachine(), 0);
+    }
+
+    template <class S> void OnFailure(S& s, int m, int c) {
+      if(s.GetClock() - group_time_[m] >= threshold_) {
+        s.ReplaceAll(m, false);
+        group_time_[m] = s.GetClock();
+      }
+      else {
+        s.Replace(m, c, false);
+      }
+    }
+
+    template <class S> void OnPlanned(S&, int, int) {}
+
+  private:
+    double threshold_;
+    std::vector<double> group_time_;
+  }; // class ThresholdPolicy
+
+  // runtime front end, policy is one of on_demand, broadcast, age, block or
+  // threshold and parameter is the age, interval or threshold in hours. an age
+  // or interval must be positive, as must the fleet size and hours
+  FleetResult RunFleetSimulation(std::string, double, int, int, double,
+                                 EventModel<int>&, EventModel<int>&, MaintenanceCosts);
+  void LogFleetResult(std::string, FleetResult&, double);
+
+} // namespace milling
+
+#endif // MILLING_FLEET_H_
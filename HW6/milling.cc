@@ -4,15 +4,20 @@
 #include <sstream>
 #include <iomanip>
 #include <limits>
+#include <memory>
+#include <chrono>
 
 #include "milling.h"
+#include "fleet.h"
+#include "optimizer.h"
 
 using namespace milling;
 
 const int kNDay = 100000;
+const uint64_t kReplicationSeed = 0x2545f4914f6cdd1dULL;
+const uint32_t kModelVersion = 2; // bump when a change alters the results of a scenario
 
 Logger::Logger() {
-  log_file_.open("log.txt", std::ios_base::app);
 }
 
 Logger::~Logger() {
@@ -20,6 +25,7 @@ Logger::~Logger() {
 }
 
 void Logger::Log(std::string log) {
+  if(!log_file_.is_open()) log_file_.open("log.txt", std::ios_base::app);
   log_file_ << log;
   log_file_ << std::endl;
 }
@@ -52,89 +58,229 @@ EventModel<T>::EventModel(int n_decimal, std::vector<T> options, std::vector<flo
   n_options_ = options_.size();
   cum_prob_.resize(n_options_);
   cum_sum_.resize(n_options_);
+  range_ = std::pow(10, n_decimal_);
   SetCumProb();
   SetCumSum();
+  SetTable();
 }
 
+// event of every r in [0, 10^n_decimal), so sampling is a single lookup
 template <class T>
-T EventModel<T>::GetEvent() {
-  int r = std::rand();
-  int range = std::pow(10, n_decimal_);
-  r = r % range;
+void EventModel<T>::SetTable() {
+  table_.resize(range_);
+  table_[0] = options_.back();
 
-  if(r == 0) return options_.back();
+  for(uint64_t r = 1; r < range_; r++) {
+    int i = 0;
+    while(i < n_options_ && (int)r > cum_sum_[i]) i++;
+
+    if(i == n_options_) throw ((int)r);
+    table_[r] = options_[i];
+  }
+}
+
+template <class T>
+T EventModel<T>::GetEvent(common::Random& random) {
+  return table_[random.Next() * range_ >> 32];
+}
+
+// maps n uniform 32 bit draws onto events
+template <class T>
+void EventModel<T>::FillEvents(const uint32_t* random, T* events, int n) {
+  for(int i = 0; i < n; i++)
+    events[i] = table_[random[i] * range_ >> 32];
+}
+
+// the distribution FillEvents actually samples, one point per table entry
+template <class T>
+common::Distribution<T> EventModel<T>::GetDistribution() {
+  common::Distribution<T> distribution;
+  for(const T& event : table_)
+    distribution.Add(event, 1.0 / range_);
+
+  return distribution;
+}
+
+// largest gap between a declared probability and the sampled one
+template <class T>
+float EventModel<T>::GetQuantizationError() {
+  common::Distribution<T> distribution = GetDistribution();
+  float error = 0;
 
   for(int i = 0; i < n_options_; i++) {
-    if(r <= cum_sum_[i]) return options_[i];
+    auto point = distribution.GetPoints().find(options_[i]);
+    float sampled = point == distribution.GetPoints().end() ? 0 : point->second;
+    error = std::max(error, std::abs(sampled - probs_[i]));
   }
 
-  throw (r);
+  return error;
 }
 
-Simulator::Simulator(EventModel<int>& life_model, EventModel<int>& delay_model)
-  : life_model_(life_model), delay_model_(delay_model) {total_delay_ = total_life_ = 0;}
+// the table as drawn: decimals, options and probabilities
+template <class T>
+void EventModel<T>::AddToKey(common::ScenarioKey& key) {
+  key.Add(n_decimal_);
+  key.Add(options_);
+  key.Add(probs_);
+}
+
+template class milling::EventModel<int>;
+
+const char* const OnDemandSimulator::kName = "on_demand";
+const char* const OnDemandSimulator::kTitle = "###On Demand Simulation###";
+const char* const BroadcastSimulator::kName = "broadcast";
+const char* const BroadcastSimulator::kTitle = "###Broadcast Simulation###";
+
+template <class Policy>
+Simulator<Policy>::Simulator(EventModel<int>& life_model, EventModel<int>& delay_model)
+  : life_model_(life_model), delay_model_(delay_model) {
+  total_delay_ = total_life_ = 0;
+  n_day_ = kNDay;
+  progress_days_ = progress_cost_ = nullptr;
+  profiler_ = nullptr;
+  sobol_ = nullptr;
+  block_start_ = 0;
+  logging_ = true;
+}
 
-int Simulator::GetDelay() {
-  return delay_model_.GetEvent();
+template <class Policy>
+void Simulator<Policy>::ResetTotals() {
+  total_delay_ = total_life_ = 0;
 }
 
-int Simulator::GetLife() {
-  return life_model_.GetEvent();
+template <class Policy>
+void Simulator<Policy>::SetNDay(int n_day) {
+  n_day_ = n_day;
 }
 
-void OnDemandSimulator::StepSimulate(std::vector<int>& day) {
-  int l, d;
+template <class Policy>
+void Simulator<Policy>::SetSeed(uint64_t seed) {
+  random_.Seed(seed, 0);
+}
+
+template <class Policy>
+long long Simulator<Policy>::GetTotalCost() {
+  return total_cost_;
+}
+
+template <class Policy>
+long long Simulator<Policy>::GetTotalLife() {
+  return total_life_;
+}
+
+template <class Policy>
+common::Distribution<int> Simulator<Policy>::GetLifeDistribution() {
+  return life_model_.GetDistribution();
+}
+
+template <class Policy>
+common::Distribution<int> Simulator<Policy>::GetDelayDistribution() {
+  return delay_model_.GetDistribution();
+}
+
+template <class Policy>
+void Simulator<Policy>::FillLives(DayBlock& block, int bearing, int n) {
+  if(sobol_) sobol_->Fill(block.random, block_start_, n, bearing);
+  else random_.Fill(block.random, n);
+  life_model_.FillEvents(block.random, block.life[bearing], n);
+}
+
+template <class Policy>
+void Simulator<Policy>::FillDelays(DayBlock& block, int bearing, int n) {
+  if(sobol_) sobol_->Fill(block.random, block_start_, n, 3 + bearing);
+  else random_.Fill(block.random, n);
+  delay_model_.FillEvents(block.random, block.delay[bearing], n);
+}
+
+void OnDemandSimulator::StepBlock(DayBlock& block, int n) {
   for(int i = 0; i < 3; i++) {
-    l = GetLife();
-    d = GetDelay();
-    day[2*i] = l;
-    day[2*i + 1] = d;
+    FillLives(block, i, n);
+    FillDelays(block, i, n);
   }
 }
 
-void BroadcastSimulator::StepSimulate(std::vector<int>& day) {
-  int l;
-  int min = std::numeric_limits<int>::max();
+// every bearing gets a life, the single repair only one delay
+void BroadcastSimulator::StepBlock(DayBlock& block, int n) {
+  for(int i = 0; i < 3; i++)
+    FillLives(block, i, n);
+
+  FillDelays(block, 0, n);
+}
+
+template <class Policy>
+void Simulator<Policy>::UpdateTotals(long long l, long long d) {
+  total_delay_ += d;
+  total_life_ += l;
+}
+
+void OnDemandSimulator::UpdateTotals(DayBlock& block, int n) {
+  long long life = 0, delay = 0;
 
   for(int i = 0; i < 3; i++) {
-    l = GetLife();
-    day[i] = l;
+    for(int j = 0; j < n; j++) {
+      life += block.life[i][j];
+      delay += block.delay[i][j];
+    }
+  }
+
+  Simulator::UpdateTotals(life, delay);
+}
 
-    if(min > l) min = l;
+// the machine runs until its first bearing fails
+void BroadcastSimulator::UpdateTotals(DayBlock& block, int n) {
+  long long min_life = 0, delay = 0;
+
+  for(int j = 0; j < n; j++) {
+    min_life += std::min(std::min(block.life[0][j], block.life[1][j]), block.life[2][j]);
+    delay += block.delay[0][j];
   }
 
-  day[3] = min;
-  day[4] = GetDelay();
+  Simulator::UpdateTotals(min_life * 3, delay);
 }
 
-void Simulator::UpdateTotals(int l, int d) {
-  total_delay_ += d;
-  total_life_ += l;
+// a day's life is the sum of three lives and its delay the sum of three delays
+bool OnDemandSimulator::GetDayDistributions(common::Distribution<int>& life,
+                                            common::Distribution<int>& delay) {
+  common::Distribution<int> l = GetLifeDistribution(), d = GetDelayDistribution();
+  if(l.GetSumSupport(3) > common::kMaxExactSupport || d.GetSumSupport(3) > common::kMaxExactSupport)
+    return false;
+
+  life = l.GetSum(l).GetSum(l);
+  delay = d.GetSum(d).GetSum(d);
+  return true;
 }
 
-void OnDemandSimulator::UpdateTotals(std::vector<int>& day) {
-  for(int i = 0; i < 3; i++)
-    Simulator::UpdateTotals(day[2*i], day[2*i + 1]);
+// three bearings run for the shortest life, with a single delay
+bool BroadcastSimulator::GetDayDistributions(common::Distribution<int>& life,
+                                             common::Distribution<int>& delay) {
+  life = GetLifeDistribution().GetMin(3).Map([](int l) { return 3 * l; });
+  delay = GetDelayDistribution();
+  return true;
 }
 
-void BroadcastSimulator::UpdateTotals(std::vector<int>& day) {
-  Simulator::UpdateTotals(day[3] * 3, day[4]);
+template <class Policy>
+void Simulator<Policy>::Log(std::string s) {
+  if(logging_) logger_.Log(s);
 }
 
-void Simulator::Log(std::string s) {
-  logger_.Log(s);
+template <class Policy>
+void Simulator<Policy>::SetLogging(bool logging) {
+  logging_ = logging;
 }
 
-void Simulator::SetCosts(int n_cols) {
-  cost_bearings_ = 3 * kNDay * 32;
+template <class Policy>
+void Simulator<Policy>::SetCosts(int n_day) {
+  int repair_minutes = Policy::kRepairs * Policy::kRepairMinutes;
+  cost_bearings_ = 3LL * n_day * 32;
   cost_delay_ = total_delay_ * 10;
-  cost_downtime_ = n_cols == 6 ? 3 * kNDay * 20 * 10 : kNDay * 40 * 10;
-  cost_repair_ = n_cols == 6 ? 3 * kNDay * 20 * 30 / 60 : kNDay * 40 * 30 / 60;
+  cost_downtime_ = (long long)n_day * repair_minutes * 10;
+  cost_repair_ = (long long)n_day * repair_minutes * 30 / 60;
   total_cost_ = cost_bearings_ + cost_delay_ + cost_downtime_ + cost_repair_;
   total_cost_per_10k_hour = total_cost_ / ((float)total_life_ / 10000);
 }
 
-void Simulator::LogMetrics() {
+template <class Policy>
+void Simulator<Policy>::LogMetrics() {
   std::stringstream metrics;
   metrics << "Cost of bearings: " << cost_bearings_ << std::endl
           << "Cost of delay time: " << cost_delay_ << std::endl
@@ -149,38 +295,489 @@ void Simulator::LogMetrics() {
   Log(metrics_string);
 }
 
-void Simulator::RunSimulation(int n_cols) {
-  if(kNDay == 0) return;
+template <class Policy>
+void Simulator<Policy>::RunSimulation() {
+  if(n_day_ == 0) return;
   std::stringstream initial_log;
-  std::string title = n_cols == 6 ? "###On Demand Simulation###" : "###Broadcast Simulation###";
-  initial_log << title << std::endl
-        << "Days: " << kNDay << std::endl
+  initial_log << Policy::kTitle << std::endl
+        << "Days: " << n_day_ << std::endl
     ;
   Log(initial_log.str());
-  std::vector<int> day(n_cols, 0);
 
-  for(int i = 0; i < kNDay; i++) {
-    StepSimulate(day);
-    UpdateTotals(day);
+  std::string name = Policy::kName;
+  if(profiler_) profiler_->Begin(name + " main loop");
+  SimulateDays();
+
+  if(profiler_) {
+    profiler_->AddEvents(name + " main loop", n_day_);
+    profiler_->Begin(name + " costs and log");
+  }
+  SetCosts(n_day_);
+  LogMetrics();
+  if(profiler_) profiler_->End();
+}
+
+template <class Policy>
+void Simulator<Policy>::SimulateDays() {
+  Policy& policy = static_cast<Policy&>(*this);
+  std::unique_ptr<DayBlock> block(new DayBlock);
+
+  for(block_start_ = 0; block_start_ < n_day_; block_start_ += DayBlock::kSize) {
+    int n = n_day_ - block_start_ < DayBlock::kSize ? n_day_ - block_start_ : DayBlock::kSize;
+    policy.StepBlock(*block, n);
+    policy.UpdateTotals(*block, n);
+
+    if(progress_days_) PublishProgress(block_start_ + n);
+  }
+}
+
+// randomized quasi monte carlo: every replication runs n_day days on a newly
+// scrambled Sobol net and gives one cost per 10k hours, so the spread between
+// replications is an honest error estimate. n_day should be a power of two.
+template <class Policy>
+common::Summary Simulator<Policy>::RunQuasiSimulation(int n_day, int n_replication) {
+  common::Summary costs;
+  common::Sobol sobol;
+  int n_day_saved = n_day_;
+
+  n_day_ = n_day;
+  sobol_ = &sobol;
+  for(int r = 0; r < n_replication; r++) {
+    sobol.Seed(r);
+    ResetTotals();
+    SimulateDays();
+    SetCosts(n_day_);
+    costs.Add(total_cost_ / ((double)total_life_ / 10000));
+  }
+  sobol_ = nullptr;
+  n_day_ = n_day_saved;
+
+  std::stringstream log;
+  log << Policy::kTitle << std::endl
+      << "quasi monte carlo, " << n_replication << " replications of " << n_day << " days" << std::endl
+      << "cost per 10k hour: " << costs.GetMean() << " +- " << costs.GetHalfWidth() << " (95%)" << std::endl;
+  Log(log.str());
+
+  return costs;
+}
+
+// replications [first, first + count) of n_day pseudo random days, a shard of
+// common::ShardRunner. replication r runs on stream r of one seed, so it
+// draws the same days whichever worker runs it
+template <class Policy>
+common::PartialResult Simulator<Policy>::RunReplications(int n_day, int64_t first, int64_t count) {
+  common::PartialResult result;
+  std::string name = std::string(Policy::kName) + " cost per 10k hour";
+  int n_day_saved = n_day_;
+
+  n_day_ = n_day;
+  for(int64_t r = first; r < first + count; r++) {
+    random_.Seed(kReplicationSeed, r);
+    ResetTotals();
+    SimulateDays();
+    SetCosts(n_day_);
+    result.Add(name, total_cost_ / ((double)total_life_ / 10000));
+  }
+  n_day_ = n_day_saved;
+
+  return result;
+}
+
+// everything RunReplications(n_day, ...) depends on, the costs are constants
+// of SetCosts and go with kModelVersion
+template <class Policy>
+common::ScenarioKey Simulator<Policy>::GetScenarioKey(int n_day) {
+  common::ScenarioKey key("hw6");
+  key.Add(kModelVersion);
+  key.Add(std::string(Policy::kName));
+  key.Add(n_day);
+  life_model_.AddToKey(key);
+  delay_model_.AddToKey(key);
+  key.Add(kReplicationSeed);
+  return key;
+}
+
+// phases of RunSimulation under the policy's name, days are the events
+template <class Policy>
+void Simulator<Policy>::SetProfiler(common::PhaseProfiler& profiler) {
+  profiler_ = &profiler;
+}
+
+template <class Policy>
+void Simulator<Policy>::SetProgress(common::ProgressRegistry& registry) {
+  std::string name = Policy::kName;
+  progress_days_ = registry.AddCounter("hw6." + name + ".days");
+  progress_cost_ = registry.AddGauge("hw6." + name + ".cost_per_10k_hour");
+}
+
+// publishes the cost estimate over the first n_day days
+template <class Policy>
+void Simulator<Policy>::PublishProgress(int n_day) {
+  SetCosts(n_day);
+  progress_days_->SetCount(n_day);
+  progress_cost_->Set(total_cost_per_10k_hour);
+}
+
+// exact cost per 10k hours, E[day cost] / E[day life], and the variance of
+// one day's term of that ratio by the delta method. the bearing, downtime and
+// repair costs are fixed per day so only the delay makes the cost random.
+// false when the convolutions are too large, then simulate instead.
+template <class Policy>
+bool Simulator<Policy>::GetExactCost(double& mean, double& variance) {
+  common::Distribution<int> life, delay;
+  if(!static_cast<Policy&>(*this).GetDayDistributions(life, delay)) return false;
+
+  int repair_minutes = Policy::kRepairs * Policy::kRepairMinutes;
+  double cost = 3 * 32 + delay.GetMean() * 10 + repair_minutes * 10 + repair_minutes * 30 / 60.0;
+  double ratio = cost / life.GetMean();
+
+  mean = ratio * 10000;
+  variance = (100 * delay.GetVariance() + ratio * ratio * life.GetVariance())
+    / (life.GetMean() * life.GetMean()) * 1e8;
+  return true;
+}
+
+// compares the simulated cost with the exact one, a large z score means the
+// simulator does not sample the model it was given
+template <class Policy>
+void Simulator<Policy>::LogAccuracy() {
+  double mean, variance;
+  std::stringstream accuracy;
+  accuracy << Policy::kName << std::endl;
+
+  if(!GetExactCost(mean, variance)) {
+    accuracy << "model too large for exact evaluation" << std::endl;
+  }
+  else {
+    double simulated = total_cost_ / ((double)total_life_ / 10000);
+    accuracy << "simulated cost per 10k hour: " << simulated << std::endl
+             << "exact cost per 10k hour: " << mean << std::endl
+             << "z score: " << common::GetZScore(simulated, mean, variance, n_day_) << std::endl;
+  }
+
+  float quantization = std::max(life_model_.GetQuantizationError(),
+                                delay_model_.GetQuantizationError());
+  accuracy << "largest table quantization error: " << quantization << std::endl;
+
+  std::string accuracy_string = accuracy.str();
+  Log(accuracy_string);
+  std::cout << accuracy_string;
+}
+
+template class milling::Simulator<OnDemandSimulator>;
+template class milling::Simulator<BroadcastSimulator>;
+
+PolicyType milling::GetPolicyType(std::string name) {
+  if(name == OnDemandSimulator::kName) return PolicyType::kOnDemand;
+  if(name == BroadcastSimulator::kName) return PolicyType::kBroadcast;
+
+  throw "UNKNOWN POLICY";
+}
+
+const int PairedSimulator::kMinBatch = 30;
+const double PairedSimulator::kRelativePrecision = 0.01;
+
+PairedSimulator::PairedSimulator(EventModel<int>& life_model, EventModel<int>& delay_model)
+  : on_demand_(life_model, delay_model), broadcast_(life_model, delay_model) {
+  on_demand_cost_ = on_demand_life_ = broadcast_cost_ = broadcast_life_ = 0;
+  n_day_ = 0;
+}
+
+// simulates blocks of days until the half width of the difference is within
+// kRelativePrecision of its mean or max_day days are done. each block is one
+// batch of the paired estimate. stopping on a relative precision keeps the
+// 95% coverage as the precision shrinks, which stopping as soon as the
+// interval excludes zero would not
+void PairedSimulator::RunSimulation(int max_day) {
+  std::unique_ptr<DayBlock> block(new DayBlock);
+
+  while(n_day_ < max_day) {
+    int n = max_day - n_day_ < DayBlock::kSize ? max_day - n_day_ : DayBlock::kSize;
+    on_demand_.ResetTotals();
+    broadcast_.ResetTotals();
+
+    on_demand_.StepBlock(*block, n);
+    on_demand_.UpdateTotals(*block, n);
+    broadcast_.UpdateTotals(*block, n);
+    on_demand_.SetCosts(n);
+    broadcast_.SetCosts(n);
+    n_day_ += n;
+
+    on_demand_cost_ += on_demand_.GetTotalCost();
+    on_demand_life_ += on_demand_.GetTotalLife();
+    broadcast_cost_ += broadcast_.GetTotalCost();
+    broadcast_life_ += broadcast_.GetTotalLife();
+
+    double on_demand = on_demand_.GetTotalCost() / ((double)on_demand_.GetTotalLife() / 10000);
+    double broadcast = broadcast_.GetTotalCost() / ((double)broadcast_.GetTotalLife() / 10000);
+    on_demand_batch_.Add(on_demand);
+    broadcast_batch_.Add(broadcast);
+    difference_.Add(on_demand - broadcast);
+
+    if(difference_.GetCount() >= kMinBatch
+       && difference_.GetHalfWidth() <= kRelativePrecision * std::abs(difference_.GetMean()))
+      break;
   }
 
-  SetCosts(n_cols);
   LogMetrics();
 }
 
-int main() {
+// the costs are ratios of the totals, the difference and its interval are
+// the mean over the batches of their differences
+void PairedSimulator::LogMetrics() {
+  double on_demand = on_demand_cost_ / ((double)on_demand_life_ / 10000);
+  double broadcast = broadcast_cost_ / ((double)broadcast_life_ / 10000);
+  double independent_variance = on_demand_batch_.GetVariance() + broadcast_batch_.GetVariance();
+  double difference = difference_.GetMean();
+  bool precise = difference_.GetCount() >= kMinBatch
+    && difference_.GetHalfWidth() <= kRelativePrecision * std::abs(difference);
+
+  std::stringstream metrics;
+  metrics << "###Paired Simulation###" << std::endl
+          << "Days: " << n_day_ << std::endl
+          << "On demand cost per 10k hour: " << on_demand << std::endl
+          << "Broadcast cost per 10k hour: " << broadcast << std::endl
+          << "Difference per 10k hour: " << difference << " +- " << difference_.GetHalfWidth()
+          << " (95%, " << difference_.GetCount() << " batch means, "
+          << (precise ? "stopped at the precision" : "stopped at max days") << ")" << std::endl
+          << "Variance reduction over independent runs: "
+          << independent_variance / difference_.GetVariance() << std::endl
+          << "Cheaper policy: " << (difference < 0 ? OnDemandSimulator::kName : BroadcastSimulator::kName)
+          << std::endl
+    ;
+
+  std::string metrics_string = metrics.str();
+  on_demand_.Log(metrics_string);
+  std::cout << metrics_string;
+}
+
+template <class Policy>
+void RunSimulation(EventModel<int>& life_model, EventModel<int>& delay_model, uint64_t seed,
+                   const SimulationConfig& config) {
+  Policy simulator(life_model, delay_model);
+  const std::string& mode = config.mode;
+
+  if(mode == "shard") {
+    common::ShardRunner runner(config.n_worker);
+    int n_shard = config.n_shard ? config.n_shard : 4 * runner.GetNWorker();
+    auto run = [&](int64_t first, int64_t count) {
+      return runner.Run(count, n_shard, [&](int64_t shard_first, int64_t shard_count) {
+        return simulator.RunReplications(config.qmc_day, first + shard_first, shard_count);
+      });
+    };
+
+    common::PartialResult result;
+    int64_t n_cached = 0;
+    if(config.cache_dir.empty()) {
+      result = run(0, config.n_replication);
+    }
+    else {
+      common::ResultCache cache(config.cache_dir);
+      result = cache.Run(simulator.GetScenarioKey(config.qmc_day), config.n_replication, run);
+      n_cached = cache.GetNCached();
+    }
+
+    const common::Summary& costs = result.GetSummaries().begin()->second;
+    std::cout << Policy::kName << " cost per 10k hour over " << costs.GetCount() << " replications: "
+              << costs.GetMean() << " +- " << costs.GetHalfWidth() << " (" << runner.GetNRerun()
+              << " shards rerun, " << n_cached << " cached)" << std::endl;
+    return;
+  }
+
+  if(mode == "qmc") {
+    common::Summary costs = simulator.RunQuasiSimulation(config.qmc_day, config.n_replication);
+    std::cout << Policy::kName << " qmc cost per 10k hour: " << costs.GetMean()
+              << " +- " << costs.GetHalfWidth() << std::endl;
+    return;
+  }
+
+  double mean, variance;
+  if(mode == "exact" && simulator.GetExactCost(mean, variance)) {
+    std::stringstream exact;
+    exact << Policy::kName << " exact cost per 10k hour: " << mean;
+    simulator.Log(exact.str());
+    std::cout << exact.str() << std::endl;
+    return;
+  }
+
+  simulator.SetNDay(config.n_day);
+  simulator.SetSeed(seed);
+  if(config.progress) simulator.SetProgress(*config.progress);
+  if(config.profiler) simulator.SetProfiler(*config.profiler);
+  simulator.RunSimulation();
+  if(mode == "check") simulator.LogAccuracy();
+}
+
+// the only place a policy is picked at runtime, everything below it is static
+void milling::RunPolicySimulation(PolicyType type, EventModel<int>& life_model,
+                                  EventModel<int>& delay_model, const SimulationConfig& config) {
+  switch(type) {
+  case PolicyType::kOnDemand:
+    RunSimulation<OnDemandSimulator>(life_model, delay_model, 1, config);
+    break;
+  case PolicyType::kBroadcast:
+    RunSimulation<BroadcastSimulator>(life_model, delay_model, 2, config);
+    break;
+  default:
+    throw (type);
+  }
+}
+
+// the batch runner links the simulator without this main
+#ifndef SIMULATION_NO_MAIN
+int main(int argc, char* argv[]) {
+  const int kProgressIntervalMs = 1000;
   std::vector<int> life_options {1000, 1100, 1200, 1300, 1400, 1500, 1600, 1700, 1800, 1900};
   std::vector<float> life_probs {0.1, 0.13, 0.25, 0.13, 0.09, 0.12, 0.02, 0.06, 0.05, 0.05};
   std::vector<int> delay_options {5, 10, 15};
   std::vector<float> delay_probs {0.6, 0.3, 0.1};
 
   EventModel<int> life_model(2, life_options, life_probs), delay_model(1, delay_options, delay_probs);
-  OnDemandSimulator on_demand_simulator(life_model, delay_model);
-  BroadcastSimulator broadcast_simulator(life_model, delay_model);
+  std::vector<PolicyType> policies {PolicyType::kOnDemand, PolicyType::kBroadcast};
+  SimulationConfig config = {kNDay, "simulate", 1 << 16, 16, 0, 0, "", nullptr, nullptr};
+  std::string fleet_policy, progress_target;
+  double fleet_parameter = 1500, fleet_hours = 100000;
+  int n_machine = 1000, n_component = 3, paired_day = 0, n_thread = 0;
+  double optimize_hours = 0;
+  MaintenanceCosts costs;
+  common::ProgressRegistry progress;
+  std::unique_ptr<common::ProgressSampler> sampler;
+  common::PhaseProfiler profiler;
+
+  // options come in pairs:
+  //   policy <on_demand|broadcast>: simulate only that policy
+  //   days <n>: simulate n days instead of kNDay
+  //   paired <max days>: compare both policies on common random numbers,
+  //     until the difference is known to 1% or max days are done
+  //   fleet <on_demand|broadcast|age|block|threshold>: run the event driven fleet engine
+  //   machines <n>, components <n>, hours <h>: fleet size and horizon
+  //   parameter <h>: replacement age, block interval or threshold of the fleet policy
+  //   optimize <max hours>: search the policy family for the cheapest policy
+  //   threads <n>: optimizer threads, 0 for one per hardware thread
+  //   part_cost, downtime_cost, repairer_cost <price>: per part, minute and hour
+  //   single_repair, group_repair <minutes>: repair time of one part or all
+  //   progress <target>: publish progress to stderr (-), unix:<socket> or a
+  //     file, not with mode shard
+  //   mode <simulate|exact|check|qmc|shard>: exact skips simulating when the
+  //     tables are small enough, check simulates and compares with the exact
+  //     cost, qmc runs replications of scrambled Sobol nets, shard runs
+  //     pseudo random replications in worker processes
+  //   qmc_days <n>, replications <n>: size of the qmc and shard runs
+  //   shards <n>: pieces the shard replications are cut into, 4 per worker by default
+  //   workers <n>: worker processes, one per hardware thread by default
+  //   cache <dir>: reuse the shard replications of a scenario stored in dir
+  //     and store the new ones there
+  //   profile on: hardware counters of each phase, wall clock where not allowed
+  for(int i = 1; i + 1 < argc; i += 2) {
+    std::string option = argv[i], value = argv[i + 1];
+
+    if(option == "policy") {
+      policies = {GetPolicyType(value)};
+    }
+    else if(option == "days") {
+      config.n_day = std::stoi(value);
+    }
+    else if(option == "paired") {
+      paired_day = std::stoi(value);
+    }
+    else if(option == "fleet") {
+      fleet_policy = value;
+    }
+    else if(option == "machines") {
+      n_machine = std::stoi(value);
+    }
+    else if(option == "components") {
+      n_component = std::stoi(value);
+    }
+    else if(option == "hours") {
+      fleet_hours = std::stod(value);
+    }
+    else if(option == "parameter") {
+      fleet_parameter = std::stod(value);
+    }
+    else if(option == "optimize") {
+      optimize_hours = std::stod(value);
+    }
+    else if(option == "threads") {
+      n_thread = std::stoi(value);
+    }
+    else if(option == "part_cost") {
+      costs.component = std::stod(value);
+    }
+    else if(option == "downtime_cost") {
+      costs.downtime_per_minute = std::stod(value);
+    }
+    else if(option == "repairer_cost") {
+      costs.repairer_per_hour = std::stod(value);
+    }
+    else if(option == "single_repair") {
+      costs.single_repair_minutes = std::stod(value);
+    }
+    else if(option == "group_repair") {
+      costs.group_repair_minutes = std::stod(value);
+    }
+    else if(option == "progress") {
+      progress_target = value;
+    }
+    else if(option == "mode") {
+      config.mode = value;
+    }
+    else if(option == "qmc_days") {
+      config.qmc_day = std::stoi(value);
+    }
+    else if(option == "replications") {
+      config.n_replication = std::stoi(value);
+    }
+    else if(option == "shards") {
+      config.n_shard = std::stoi(value);
+    }
+    else if(option == "workers") {
+      config.n_worker = std::stoi(value);
+    }
+    else if(option == "cache") {
+      config.cache_dir = value;
+    }
+    else if(option == "profile") {
+      config.profiler = &profiler;
+    }
+  }
+
+  if(config.qmc_day < 1 || config.n_replication < 1) throw "NO REPLICATIONS";
+  // shard forks its workers, which must not inherit a sampler thread, and
+  // the workers' progress would not reach it anyway
+  if(config.mode == "shard" && !progress_target.empty()) throw "NO PROGRESS WITH MODE SHARD";
 
-  on_demand_simulator.RunSimulation(6);
-  broadcast_simulator.RunSimulation(5);
+  if(!progress_target.empty()) {
+    sampler.reset(new common::ProgressSampler(progress, progress_target, kProgressIntervalMs));
+    sampler->Start();
+    config.progress = &progress;
+  }
+
+  if(paired_day) {
+    PairedSimulator simulator(life_model, delay_model);
+    simulator.RunSimulation(paired_day);
+    return 0;
+  }
+
+  if(optimize_hours > 0) {
+    PolicyOptimizer optimizer(life_model, delay_model, costs, n_thread);
+    optimizer.SetFleet(n_machine, n_component, fleet_hours);
+    optimizer.RunOptimization(optimize_hours);
+    return 0;
+  }
+
+  if(!fleet_policy.empty()) {
+    auto start = std::chrono::steady_clock::now();
+    FleetResult result = RunFleetSimulation(fleet_policy, fleet_parameter, n_machine, n_component,
+                                            fleet_hours, life_model, delay_model, costs);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    LogFleetResult("###Fleet " + fleet_policy + " Simulation###", result, elapsed.count());
+    return 0;
+  }
+
+  for(PolicyType policy : policies) RunPolicySimulation(policy, life_model, delay_model, config);
+  if(config.profiler) std::cout << profiler.GetReport();
 
   return 0;
 }
-
+#endif // SIMULATION_NO_MAIN
@@ -5,6 +5,14 @@
 #include <sstream>
 #include <fstream>
 
+#include "../common/progress.h"
+#include "../common/perf.h"
+#include "../common/random.h"
+#include "../common/statistics.h"
+#include "../common/exact.h"
+#include "../common/sobol.h"
+#include "../common/cache.h"
+
 namespace milling {
 
   template <class T>
@@ -13,18 +21,25 @@ namespace milling {
     EventModel();
     EventModel(int, std::vector<T>, std::vector<float>);
 
-    T GetEvent();
+    T GetEvent(common::Random&);
+    void FillEvents(const uint32_t*, T*, int);
+    common::Distribution<T> GetDistribution();
+    float GetQuantizationError();
+    void AddToKey(common::ScenarioKey&);
 
   private:
     int n_decimal_, n_options_;
+    uint64_t range_;
     std::vector<int> cum_sum_;
-    std::vector<T> options_;
+    std::vector<T> options_, table_;
     std::vector<float> probs_, cum_prob_;
 
     void SetCumProb();
     void SetCumSum();
+    void SetTable();
   }; // class EventModel
 
+  // log.txt is opened on the first Log, appending
   class Logger {
   public:
     Logger();
@@ -36,45 +51,130 @@ namespace milling {
     std::ofstream log_file_;
   }; // class Logger
 
+  // random draws for kSize days in structure of arrays form, lives and
+  // delays of bearing i live in life[i] and delay[i]
+  struct DayBlock {
+    static const int kSize = 4096;
+    uint32_t random[kSize];
+    int life[3][kSize], delay[3][kSize];
+  }; // struct DayBlock
+
+  // shared state and reporting. Policy derives from Simulator<Policy> and
+  // provides StepBlock(DayBlock&, int), drawing what it needs for a block of
+  // days, and UpdateTotals(DayBlock&, int). both are called directly so the
+  // block loops are inlined and vectorized in RunSimulation. for the exact
+  // evaluation Policy also provides GetDayDistributions(life, delay), the
+  // distributions of one day's total life and delay. under quasi monte carlo
+  // FillLives and FillDelays take bearing i's life from Sobol dimension i and
+  // its delay from dimension 3 + i.
+  template <class Policy>
   class Simulator {
   public:
     Simulator(EventModel<int>&, EventModel<int>&);
 
-    virtual void StepSimulate(std::vector<int>&) = 0;
-    virtual void UpdateTotals(std::vector<int>&) = 0;
-
     void ResetTotals();
     void LogMetrics();
-    void RunSimulation(int);
-    void UpdateTotals(int, int);
-    int GetLife(), GetDelay();
+    void RunSimulation();
+    common::Summary RunQuasiSimulation(int, int);
+    common::PartialResult RunReplications(int, int64_t, int64_t);
+    common::ScenarioKey GetScenarioKey(int);
+    void UpdateTotals(long long, long long);
+    void FillLives(DayBlock&, int, int), FillDelays(DayBlock&, int, int);
     void Log(std::string);
+    void SetLogging(bool);
     void SetCosts(int);
+    void SetNDay(int);
+    void SetSeed(uint64_t);
+    void SetProgress(common::ProgressRegistry&);
+    void SetProfiler(common::PhaseProfiler&);
+    void PublishProgress(int);
+    long long GetTotalCost(), GetTotalLife();
+    common::Distribution<int> GetLifeDistribution(), GetDelayDistribution();
+    bool GetExactCost(double&, double&);
+    void LogAccuracy();
 
   private:
+    void SimulateDays();
+
     Logger logger_;
+    common::ProgressValue *progress_days_, *progress_cost_;
+    common::PhaseProfiler* profiler_;
+    common::RandomLanes<8> random_;
+    const common::Sobol* sobol_;
+    int block_start_;
+    bool logging_;
     EventModel<int> life_model_, delay_model_;
-    int total_delay_, total_life_, cost_bearings_, cost_delay_, cost_downtime_,
-      cost_repair_, total_cost_, total_cost_per_10k_hour;
+    int n_day_, total_cost_per_10k_hour;
+    long long total_delay_, total_life_, cost_bearings_, cost_delay_, cost_downtime_,
+      cost_repair_, total_cost_;
   }; // class Simulator
 
-  class OnDemandSimulator : public Simulator {
+  // replaces only the failed bearing, one repair per bearing
+  class OnDemandSimulator : public Simulator<OnDemandSimulator> {
   public:
+    static const int kRepairs = 3, kRepairMinutes = 20;
+    static const char* const kName;
+    static const char* const kTitle;
+
     using Simulator::Simulator;
 
-    virtual void StepSimulate(std::vector<int>&);
-    virtual void UpdateTotals(std::vector<int>&);
-  private:
+    void StepBlock(DayBlock&, int);
+    void UpdateTotals(DayBlock&, int);
+    bool GetDayDistributions(common::Distribution<int>&, common::Distribution<int>&);
   }; // class OnDemandSimulator
 
-  class BroadcastSimulator : public Simulator{
+  // replaces all three bearings when the first one fails
+  class BroadcastSimulator : public Simulator<BroadcastSimulator> {
   public:
+    static const int kRepairs = 1, kRepairMinutes = 40;
+    static const char* const kName;
+    static const char* const kTitle;
+
     using Simulator::Simulator;
 
-    virtual void StepSimulate(std::vector<int>&);
-    virtual void UpdateTotals(std::vector<int>&);
+    void StepBlock(DayBlock&, int);
+    void UpdateTotals(DayBlock&, int);
+    bool GetDayDistributions(common::Distribution<int>&, common::Distribution<int>&);
+  }; // class BroadcastSimulator
+
+  // both policies on the same draws. every day's three lives and delays are
+  // drawn once, on demand uses all of them and broadcast the same lives with
+  // the first delay, so the noise of the cost difference mostly cancels
+  class PairedSimulator {
+  public:
+    PairedSimulator(EventModel<int>&, EventModel<int>&);
+
+    void RunSimulation(int);
+    void LogMetrics();
+
   private:
-  }; // class Broadcastsimulator
+    static const int kMinBatch;
+    static const double kRelativePrecision;
+    OnDemandSimulator on_demand_;
+    BroadcastSimulator broadcast_;
+    common::Summary difference_, on_demand_batch_, broadcast_batch_;
+    long long on_demand_cost_, on_demand_life_, broadcast_cost_, broadcast_life_;
+    int n_day_;
+  }; // class PairedSimulator
+
+  enum PolicyType {
+    kOnDemand = 0,
+    kBroadcast,
+  };
+
+  // a policy run of main, the fields are its options. progress and
+  // profiler may be null
+  struct SimulationConfig {
+    int n_day;
+    std::string mode;
+    int qmc_day, n_replication, n_shard, n_worker;
+    std::string cache_dir;
+    common::ProgressRegistry* progress;
+    common::PhaseProfiler* profiler;
+  };
+
+  PolicyType GetPolicyType(std::string);
+  void RunPolicySimulation(PolicyType, EventModel<int>&, EventModel<int>&, const SimulationConfig&);
 
 } // namespace milling
 
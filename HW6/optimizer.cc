@@ -0,0 +1,106 @@
+#include <future>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+#include "optimizer.h"
+
+using namespace milling;
+
+const int PolicyOptimizer::kNGrid = 9;
+const int PolicyOptimizer::kNRound = 5;
+
+PolicyOptimizer::PolicyOptimizer(EventModel<int>& life_model, EventModel<int>& delay_model,
+                                 MaintenanceCosts costs, int n_thread)
+  : life_model_(life_model), delay_model_(delay_model), costs_(costs), pool_(n_thread) {
+  n_machine_ = 1000;
+  n_component_ = 3;
+  hours_ = 100000;
+}
+
+void PolicyOptimizer::SetFleet(int n_machine, int n_component, double hours) {
+  n_machine_ = n_machine;
+  n_component_ = n_component;
+  hours_ = hours;
+}
+
+void PolicyOptimizer::Log(std::string s) {
+  logger_.Log(s);
+  std::cout << s << std::endl;
+}
+
+PolicyCandidate PolicyOptimizer::Evaluate(std::string policy, double parameter) {
+  FleetResult result = RunFleetSimulation(policy, parameter, n_machine_, n_component_, hours_,
+                                          life_model_, delay_model_, costs_);
+  return {policy, parameter, result.cost_per_10k_hour};
+}
+
+std::vector<PolicyCandidate> PolicyOptimizer::EvaluateAll(std::string policy,
+                                                          std::vector<double> parameters) {
+  std::vector<std::future<PolicyCandidate>> futures;
+  for(double parameter : parameters)
+    futures.push_back(pool_.Submit([this, policy, parameter] { return Evaluate(policy, parameter); }));
+
+  std::vector<PolicyCandidate> candidates;
+  for(std::future<PolicyCandidate>& f : futures)
+    candidates.push_back(f.get());
+
+  return candidates;
+}
+
+// evaluates a grid over [low, high] and narrows it to the neighbours of the
+// best point, kNRound times
+PolicyCandidate PolicyOptimizer::Search(std::string policy, double low, double high) {
+  PolicyCandidate best = {policy, low, std::numeric_limits<double>::infinity()};
+
+  for(int round = 0; round < kNRound; round++) {
+    std::vector<double> grid(kNGrid);
+    for(int i = 0; i < kNGrid; i++)
+      grid[i] = low + (high - low) * i / (kNGrid - 1);
+
+    std::vector<PolicyCandidate> candidates = EvaluateAll(policy, grid);
+    int b = 0;
+    for(int i = 1; i < kNGrid; i++)
+      if(candidates[i].cost_per_10k_hour < candidates[b].cost_per_10k_hour) b = i;
+
+    if(candidates[b].cost_per_10k_hour < best.cost_per_10k_hour) best = candidates[b];
+
+    std::stringstream log;
+    log << policy << " round " << round << ": [" << low << ", " << high << "] best "
+        << candidates[b].parameter << " costs " << candidates[b].cost_per_10k_hour;
+    Log(log.str());
+
+    low = grid[b > 0 ? b - 1 : 0];
+    high = grid[b < kNGrid - 1 ? b + 1 : kNGrid - 1];
+  }
+
+  return best;
+}
+
+// replacement ages and thresholds are searched up to max_hours
+PolicyCandidate PolicyOptimizer::RunOptimization(double max_hours) {
+  std::stringstream title;
+  title << "###Policy Optimization###" << std::endl
+        << "Machines: " << n_machine_ << ", parts: " << n_component_
+        << ", hours: " << hours_ << ", threads: " << pool_.GetNThread();
+  Log(title.str());
+
+  std::vector<PolicyCandidate> best;
+  best.push_back(EvaluateAll("on_demand", {0})[0]);
+  best.push_back(EvaluateAll("broadcast", {0})[0]);
+  best.push_back(Search("age", max_hours / 4, max_hours));
+  best.push_back(Search("threshold", 0, max_hours));
+
+  std::stringstream table;
+  int b = 0;
+  for(size_t i = 0; i < best.size(); i++) {
+    table << best[i].policy << " " << best[i].parameter << ": "
+          << best[i].cost_per_10k_hour << std::endl;
+    if(best[i].cost_per_10k_hour < best[b].cost_per_10k_hour) b = i;
+  }
+  table << "Best policy: " << best[b].policy << " " << best[b].parameter
+        << " with cost per 10k hour " << best[b].cost_per_10k_hour << std::endl;
+  Log(table.str());
+
+  return best[b];
+}
@@ -0,0 +1,43 @@
+#ifndef MILLING_OPTIMIZER_H_
+#define MILLING_OPTIMIZER_H_
+
+#include <string>
+#include <vector>
+
+#include "fleet.h"
+#include "../common/thread_pool.h"
+
+namespace milling {
+
+  struct PolicyCandidate {
+    std::string policy;
+    double parameter, cost_per_10k_hour;
+  }; // struct PolicyCandidate
+
+  // searches the replacement policy family for the lowest cost per 10k hours.
+  // each candidate is one fleet run on the thread pool, and every run uses the
+  // same seed so candidates are compared on common random numbers.
+  class PolicyOptimizer {
+  public:
+    PolicyOptimizer(EventModel<int>&, EventModel<int>&, MaintenanceCosts, int);
+
+    void SetFleet(int, int, double);
+    PolicyCandidate Evaluate(std::string, double);
+    std::vector<PolicyCandidate> EvaluateAll(std::string, std::vector<double>);
+    PolicyCandidate Search(std::string, double, double);
+    PolicyCandidate RunOptimization(double);
+    void Log(std::string);
+
+  private:
+    static const int kNGrid, kNRound;
+    Logger logger_;
+    EventModel<int> life_model_, delay_model_;
+    MaintenanceCosts costs_;
+    common::ThreadPool pool_;
+    int n_machine_, n_component_;
+    double hours_;
+  }; // class PolicyOptimizer
+
+} // namespace milling
+
+#endif // MILLING_OPTIMIZER_H_
@@ -0,0 +1,389 @@
+#include <chrono>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../HW1/queue.h"
+#include "../HW2/queue.h"
+#include "../HW5/news_paper.h"
+#include "../HW6/milling.h"
+#include "../HW6/fleet.h"
+#include "../prj/network.h"
+#include "../common/scenario.h"
+#include "../common/thread_pool.h"
+
+// runs every scenario of a scenario file in one process. a scenario is one
+// of the models below with the options of its main, see common/scenario.h
+// and scenarios.txt. the replications of all the scenarios are cut into
+// tasks of chunk replications on one thread pool, and replication r of a
+// scenario is the run r of its main's replications (or mode shard), so the
+// results do not depend on the number of threads. event tables are built
+// once per distinct table. build from this directory with
+//   g++ -std=c++17 -O2 -pthread -DSIMULATION_NO_MAIN batch.cc ../HW1/queue.cc
+//     ../HW2/queue.cc ../HW5/news_paper.cc ../HW6/milling.cc ../HW6/fleet.cc
+//     ../prj/network.cc
+
+typedef std::function<common::PartialResult(int64_t, int64_t)> Work;
+
+// replications [first, first + count) of a scenario by work, or one
+// evaluation that cannot be split when n_replication is 1
+struct Task {
+  int64_t n_replication;
+  Work work;
+};
+
+// a batch usually sweeps other parameters over a few tables
+template <class Model, class T>
+Model GetEventModel(std::map<std::string, Model>& models, int n_decimal, const std::vector<T>& options,
+                    const std::vector<float>& probs) {
+  if(options.size() != probs.size()) throw "BAD EVENT TABLE";
+
+  std::stringstream key;
+  key << n_decimal;
+  for(size_t i = 0; i < options.size(); i++) key << " " << options[i] << ":" << probs[i];
+
+  auto model = models.find(key.str());
+  if(model == models.end()) model = models.emplace(key.str(), Model(n_decimal, options, probs)).first;
+  return model->second;
+}
+
+std::map<std::string, single_channel_queue_simulation::EventModel> hw2_models;
+std::map<std::string, news_paper::EventModel<int>> hw5_models;
+std::map<std::string, news_paper::EventModel<news_paper::DayType>> hw5_day_models;
+std::map<std::string, milling::EventModel<int>> hw6_models;
+
+// the G/G/1 queue of HW1, replications of customers customers
+Task GetHW1Task(common::Scenario& scenario) {
+  queue_simulation::SimulationConfig config = {
+    scenario.Get<float>("lambda", 1), scenario.Get<float>("mu", 0.7),
+    scenario.Get<unsigned>("customers", 1000000), scenario.Get<std::string>("arrival", "exp"),
+    scenario.Get<std::string>("service", "exp"), "", 0, "", 0, nullptr, 0};
+
+  return Task{scenario.Get<int64_t>("replications", 1), [config](int64_t first, int64_t count) {
+    return queue_simulation::RunReplications(config, first, count);
+  }};
+}
+
+// the table driven queue of HW2. std::rand and the counts Customer shares
+// are global, so its replications run one at a time
+Task GetHW2Task(common::Scenario& scenario) {
+  using single_channel_queue_simulation::EventModel;
+  static std::mutex mutex;
+
+  int n_customer = scenario.Get<int>("customers", 100);
+  EventModel arrival_model = GetEventModel(
+    hw2_models, scenario.Get<int>("arrival_decimals", 3),
+    scenario.GetList<int>("arrival_intervals", {1, 2, 3, 4, 5, 6, 7, 8}),
+    scenario.GetList<float>("arrival_probs", std::vector<float>(8, 0.125)));
+  EventModel service_model = GetEventModel(
+    hw2_models, scenario.Get<int>("service_decimals", 2),
+    scenario.GetList<int>("service_times", {1, 2, 3, 4, 5, 6}),
+    scenario.GetList<float>("service_probs", {0.1, 0.2, 0.3, 0.25, 0.1, 0.05}));
+
+  return Task{scenario.Get<int64_t>("replications", 1), [=](int64_t first, int64_t count) {
+    std::lock_guard<std::mutex> lock(mutex);
+    EventModel arrival = arrival_model, service = service_model;
+    return single_channel_queue_simulation::RunReplications(n_customer, arrival, service, first, count);
+  }};
+}
+
+// the newsstand of HW5 with mode shard (pseudo random replications), qmc or exact
+Task GetHW5Task(common::Scenario& scenario) {
+  using news_paper::EventModel;
+  using news_paper::DayType;
+
+  int n_decimal = scenario.Get<int>("decimals", 2);
+  std::vector<int> demands = scenario.GetList<int>("demands", {40, 50, 60, 70, 80, 90, 100});
+  EventModel<DayType> day_model = GetEventModel(
+    hw5_day_models, n_decimal, std::vector<DayType>{DayType::kGood, DayType::kFair, DayType::kPoor},
+    scenario.GetList<float>("day_probs", {0.35, 0.45, 0.2}));
+  EventModel<int> good_model = GetEventModel(
+    hw5_models, n_decimal, demands,
+    scenario.GetList<float>("good_probs", {0.03, 0.05, 0.15, 0.2, 0.35, 0.15, 0.07}));
+  EventModel<int> fair_model = GetEventModel(
+    hw5_models, n_decimal, demands,
+    scenario.GetList<float>("fair_probs", {0.1, 0.18, 0.4, 0.2, 0.08, 0.04, 0}));
+  EventModel<int> poor_model = GetEventModel(
+    hw5_models, n_decimal, demands,
+    scenario.GetList<float>("poor_probs", {0.44, 0.22, 0.16, 0.12, 0.06, 0, 0}));
+
+  int n_news_paper = scenario.Get<int>("newspapers", 60);
+  int qmc_day = scenario.Get<int>("qmc_days", 1 << 16);
+  int64_t n_replication = scenario.Get<int64_t>("replications", 16);
+  std::string mode = scenario.Get<std::string>("mode", "shard");
+  if(mode != "shard" && mode != "qmc" && mode != "exact") throw "UNKNOWN MODE";
+
+  auto work = [=](int64_t first, int64_t count) {
+    EventModel<DayType> day = day_model;
+    EventModel<int> good = good_model, fair = fair_model, poor = poor_model;
+    news_paper::Simulator simulator(day, good, fair, poor);
+    simulator.SetLogging(false);
+    simulator.SetNNewsPaper(n_news_paper);
+
+    common::PartialResult result;
+    double mean, variance;
+    if(mode == "qmc")
+      result.Add("qmc profit per day", simulator.RunQuasiSimulation(qmc_day, n_replication));
+    else if(mode == "exact" && simulator.GetExactProfit(mean, variance))
+      result.Add("exact profit per day", mean);
+    else if(mode == "exact")
+      throw "MODEL TOO LARGE FOR EXACT EVALUATION";
+    else
+      result = simulator.RunReplications(qmc_day, first, count);
+    return result;
+  };
+
+  return Task{mode == "shard" ? n_replication : 1, work};
+}
+
+template <class Policy>
+common::PartialResult RunMilling(milling::EventModel<int> life, milling::EventModel<int> delay,
+                                 std::string mode, int qmc_day, int64_t n_replication,
+                                 int64_t first, int64_t count) {
+  Policy simulator(life, delay);
+  simulator.SetLogging(false);
+
+  common::PartialResult result;
+  double mean, variance;
+  std::string name = Policy::kName;
+  if(mode == "qmc")
+    result.Add(name + " qmc cost per 10k hour", simulator.RunQuasiSimulation(qmc_day, n_replication));
+  else if(mode == "exact" && simulator.GetExactCost(mean, variance))
+    result.Add(name + " exact cost per 10k hour", mean);
+  else if(mode == "exact")
+    throw "MODEL TOO LARGE FOR EXACT EVALUATION";
+  else
+    result = simulator.RunReplications(qmc_day, first, count);
+  return result;
+}
+
+milling::EventModel<int> GetLifeModel(common::Scenario& scenario) {
+  return GetEventModel(
+    hw6_models, scenario.Get<int>("life_decimals", 2),
+    scenario.GetList<int>("life_options", {1000, 1100, 1200, 1300, 1400, 1500, 1600, 1700, 1800, 1900}),
+    scenario.GetList<float>("life_probs", {0.1, 0.13, 0.25, 0.13, 0.09, 0.12, 0.02, 0.06, 0.05, 0.05}));
+}
+
+milling::EventModel<int> GetDelayModel(common::Scenario& scenario) {
+  return GetEventModel(hw6_models, scenario.Get<int>("delay_decimals", 1),
+                       scenario.GetList<int>("delay_options", {5, 10, 15}),
+                       scenario.GetList<float>("delay_probs", {0.6, 0.3, 0.1}));
+}
+
+// the day by day milling machine of HW6 under one policy, modes as in HW5
+Task GetHW6Task(common::Scenario& scenario) {
+  milling::EventModel<int> life_model = GetLifeModel(scenario), delay_model = GetDelayModel(scenario);
+  milling::PolicyType policy = milling::GetPolicyType(scenario.Get<std::string>("policy", "on_demand"));
+  int qmc_day = scenario.Get<int>("qmc_days", 1 << 16);
+  int64_t n_replication = scenario.Get<int64_t>("replications", 16);
+  std::string mode = scenario.Get<std::string>("mode", "shard");
+  if(mode != "shard" && mode != "qmc" && mode != "exact") throw "UNKNOWN MODE";
+
+  auto work = [=](int64_t first, int64_t count) {
+    if(policy == milling::PolicyType::kOnDemand)
+      return RunMilling<milling::OnDemandSimulator>(life_model, delay_model, mode, qmc_day,
+                                                    n_replication, first, count);
+    return RunMilling<milling::BroadcastSimulator>(life_model, delay_model, mode, qmc_day,
+                                                   n_replication, first, count);
+  };
+
+  return Task{mode == "shard" ? n_replication : 1, work};
+}
+
+// the event driven fleet engine of HW6, one run on its fixed seed
+Task GetFleetTask(common::Scenario& scenario) {
+  milling::EventModel<int> life_model = GetLifeModel(scenario), delay_model = GetDelayModel(scenario);
+  milling::MaintenanceCosts costs;
+  costs.component = scenario.Get<double>("part_cost", costs.component);
+  costs.downtime_per_minute = scenario.Get<double>("downtime_cost", costs.downtime_per_minute);
+  costs.repairer_per_hour = scenario.Get<double>("repairer_cost", costs.repairer_per_hour);
+  costs.single_repair_minutes = scenario.Get<double>("single_repair", costs.single_repair_minutes);
+  costs.group_repair_minutes = scenario.Get<double>("group_repair", costs.group_repair_minutes);
+  std::string policy = scenario.Get<std::string>("policy", "on_demand");
+  double parameter = scenario.Get<double>("parameter", 1500), hours = scenario.Get<double>("hours", 100000);
+  int n_machine = scenario.Get<int>("machines", 1000), n_component = scenario.Get<int>("components", 3);
+
+  return Task{1, [=](int64_t, int64_t) {
+    milling::EventModel<int> life = life_model, delay = delay_model;
+    milling::FleetResult fleet = milling::RunFleetSimulation(policy, parameter, n_machine, n_component,
+                                                             hours, life, delay, costs);
+    common::PartialResult result;
+    result.Add("cost per 10k hour", fleet.cost_per_10k_hour);
+    result.Add("failures", fleet.n_failure);
+    result.Add("planned replacements", fleet.n_planned);
+    result.Add("events", fleet.n_event);
+    return result;
+  }};
+}
+
+// the three server network of prj/tri_q.cc, replication r on seed + r
+Task GetTriQTask(common::Scenario& scenario) {
+  using namespace queue_network;
+
+  long long n_warm_up = scenario.Get<long long>("warm_up", 100000);
+  long long n_customer = scenario.Get<long long>("customers", 5000000);
+  uint64_t seed = scenario.Get<uint64_t>("seed", 86456);
+  double arrival = scenario.Get<double>("arrival", 1), p = scenario.Get<double>("p", 0.4);
+  double service[] = {scenario.Get<double>("service_1", 2), scenario.Get<double>("service_2", 4),
+                      scenario.Get<double>("service_3", 3)};
+  int n_server = scenario.Get<int>("servers", 1);
+  std::string engine_name = scenario.Get<std::string>("engine", "auto");
+  EngineType engine = engine_name == "lindley" ? kLindley : engine_name == "event" ? kEvent : kAuto;
+
+  Network network;
+  for(int i = 0; i < 3; i++)
+    network.AddNode(TimeModel::Exponential(service[i]), n_server);
+  network.AddRoute(0, 1, p);
+  network.AddRoute(0, 2, 1 - p);
+  network.AddSource(0, TimeModel::Exponential(arrival));
+
+  return Task{scenario.Get<int64_t>("replications", 1), [=](int64_t first, int64_t count) {
+    common::PartialResult result;
+    for(int64_t r = first; r < first + count; r++) {
+      Network copy = network;
+      NetworkMetrics metrics = RunNetworkSimulation(copy, n_warm_up, n_customer, seed + r, engine);
+      result.Add("R", metrics.r);
+      result.Add("N", metrics.n);
+      for(size_t i = 0; i < metrics.nodes.size(); i++) {
+        std::string node = "server " + std::to_string(i + 1) + " ";
+        result.Add(node + "WQ", metrics.nodes[i].wq);
+        result.Add(node + "L", metrics.nodes[i].l);
+        result.Add(node + "P", metrics.nodes[i].p);
+      }
+    }
+    return result;
+  }};
+}
+
+Task GetTask(common::Scenario& scenario) {
+  const std::string& model = scenario.GetModel();
+  if(model == "hw1") return GetHW1Task(scenario);
+  if(model == "hw2") return GetHW2Task(scenario);
+  if(model == "hw5") return GetHW5Task(scenario);
+  if(model == "hw6") return GetHW6Task(scenario);
+  if(model == "fleet") return GetFleetTask(scenario);
+  if(model == "tri_q") return GetTriQTask(scenario);
+
+  throw "UNKNOWN MODEL";
+}
+
+// runs f and turns whatever the simulators throw into a message
+template <class F>
+std::string GetError(F f) {
+  try {
+    f();
+  }
+  catch(const char* error) {
+    return error;
+  }
+  catch(const std::exception& error) {
+    return error.what();
+  }
+  catch(int value) {
+    return "bad value " + std::to_string(value);
+  }
+  catch(...) {
+    return "failed";
+  }
+  return "";
+}
+
+int main(int argc, char* argv[]) {
+  std::string path = "scenarios.txt", out = "batch.csv";
+  int n_thread = 0, chunk = 1;
+
+  // options come in pairs:
+  //   scenarios <path>: the scenario file, scenarios.txt by default
+  //   out <path>: csv of every metric of every scenario
+  //   threads <n>: pool threads, one per hardware thread by default
+  //   chunk <n>: replications per task, 1 by default
+  for(int i = 1; i + 1 < argc; i += 2) {
+    std::string option = argv[i], value = argv[i + 1];
+
+    if(option == "scenarios") {
+      path = value;
+    }
+    else if(option == "out") {
+      out = value;
+    }
+    else if(option == "threads") {
+      n_thread = std::stoi(value);
+    }
+    else if(option == "chunk") {
+      chunk = std::stoi(value);
+    }
+  }
+  if(chunk < 1) throw (chunk);
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<common::Scenario> scenarios = common::ReadScenarioFile(path);
+  std::vector<Task> tasks(scenarios.size());
+  std::vector<std::string> errors(scenarios.size());
+
+  for(size_t i = 0; i < scenarios.size(); i++) {
+    errors[i] = GetError([&] {
+      scenarios[i].GetName();
+      tasks[i] = GetTask(scenarios[i]);
+      if(tasks[i].n_replication < 1) throw "NO REPLICATIONS";
+    });
+    for(const std::string& key : scenarios[i].GetUnused())
+      if(errors[i].empty()) errors[i] = "unknown key " + key;
+  }
+
+  common::ThreadPool pool(n_thread);
+  std::vector<std::vector<std::future<common::PartialResult>>> done(scenarios.size());
+  int64_t n_task = 0;
+
+  for(size_t i = 0; i < scenarios.size(); i++) {
+    if(!errors[i].empty()) continue;
+
+    Task& task = tasks[i];
+    for(int64_t first = 0; first < task.n_replication; first += chunk) {
+      int64_t count = std::min<int64_t>(chunk, task.n_replication - first);
+      done[i].push_back(pool.Submit([&task, first, count] { return task.work(first, count); }));
+      n_task++;
+    }
+  }
+
+  // in file order as the scenarios finish, the tasks of one merged in order
+  std::ofstream csv(out);
+  csv << "scenario,model,metric,mean,half_width,count" << std::endl;
+  int n_failed = 0;
+
+  for(size_t i = 0; i < scenarios.size(); i++) {
+    common::PartialResult result;
+    for(auto& task : done[i]) {
+      std::string error = GetError([&] { result.Merge(task.get()); });
+      if(errors[i].empty()) errors[i] = error;
+    }
+
+    std::string name = scenarios[i].GetName();
+    if(!errors[i].empty()) {
+      std::cout << name << " (line " << scenarios[i].GetLine() << "): " << errors[i] << std::endl;
+      n_failed++;
+      continue;
+    }
+
+    // names and metrics are quoted, some metrics have commas
+    for(const auto& entry : result.GetSummaries())
+      csv << "\"" << name << "\"," << scenarios[i].GetModel() << ",\"" << entry.first << "\","
+          << entry.second.GetMean() << "," << entry.second.GetHalfWidth() << ","
+          << entry.second.GetCount() << std::endl;
+  }
+
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  std::cout << "###Batch###" << std::endl
+            << "Scenarios: " << scenarios.size() << " (" << n_failed << " failed)" << std::endl
+            << "Tasks: " << n_task << " on " << pool.GetNThread() << " threads" << std::endl
+            << "Seconds: " << elapsed.count() << std::endl
+            << "Results: " << out << std::endl;
+
+  return 0;
+}
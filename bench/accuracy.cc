@@ -0,0 +1,239 @@
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../HW1/queue.h"
+#include "../HW1/lanes.h"
+#include "../prj/network.h"
+
+// accuracy per cpu second: every engine runs on a grid of utilizations with
+// doubling customer counts, and each run's relative error against the
+// analytic answer is written with its cpu time, one error versus time curve
+// per engine and utilization. build from this directory with
+//   g++ -std=c++17 -O2 -pthread -DSIMULATION_NO_MAIN accuracy.cc
+//     ../HW1/queue.cc ../HW1/lanes.cc ../prj/network.cc
+
+struct QueueMetrics {
+  double wq, lq, w, l;
+};
+
+struct BenchPoint {
+  std::string engine;
+  double rho;
+  long long n_customer;
+  double seconds;
+  QueueMetrics metrics, error;
+};
+
+double GetCpuSeconds() {
+  return (double)std::clock() / CLOCKS_PER_SEC;
+}
+
+// M/M/1 of HW1 with mean interarrival 1 and mean service rho
+QueueMetrics GetMM1Metrics(double rho) {
+  return {rho * rho / (1 - rho), rho * rho / (1 - rho), rho / (1 - rho), rho / (1 - rho)};
+}
+
+// the network of tri_q with every server at utilization rho: server 1 feeds
+// server 2 with probability p and server 3 otherwise
+queue_network::Network GetTriNetwork(double rho, double p) {
+  queue_network::Network network;
+  network.AddNode(queue_network::TimeModel::Exponential(rho));
+  network.AddNode(queue_network::TimeModel::Exponential(rho / p));
+  network.AddNode(queue_network::TimeModel::Exponential(rho / (1 - p)));
+  network.AddRoute(0, 1, p);
+  network.AddRoute(0, 2, 1 - p);
+  network.AddSource(0, queue_network::TimeModel::Exponential(1));
+  return network;
+}
+
+// Jackson's theorem for single server exponential nodes: the arrival rates
+// solve lambda = gamma + lambda P, then every node is an M/M/1 queue. wq and
+// w are per customer over all its visits, lq and l summed over the nodes
+QueueMetrics GetJacksonMetrics(queue_network::Network& network) {
+  int n_node = network.GetNNode();
+  std::vector<double> gamma(n_node, 0), lambda(n_node, 0);
+  double total_gamma = 0;
+
+  for(int s = 0; s < network.GetNSource(); s++) {
+    queue_network::Source& source = network.GetSource(s);
+    gamma[source.node] += 1 / source.interarrival.GetMean();
+    total_gamma += 1 / source.interarrival.GetMean();
+  }
+
+  for(int iteration = 0; iteration < 10000; iteration++) {
+    std::vector<double> next = gamma;
+    for(int i = 0; i < n_node; i++) {
+      queue_network::Node& node = network.GetNode(i);
+      double previous = 0;
+      for(size_t k = 0; k < node.next.size(); k++) {
+        next[node.next[k]] += lambda[i] * (node.cum_prob[k] - previous);
+        previous = node.cum_prob[k];
+      }
+    }
+    lambda = next;
+  }
+
+  QueueMetrics metrics = {0, 0, 0, 0};
+  for(int i = 0; i < n_node; i++) {
+    queue_network::Node& node = network.GetNode(i);
+    if(node.n_server != 1) throw "JACKSON NEEDS SINGLE SERVERS";
+
+    double e_s = node.service.GetMean(), rho = lambda[i] * e_s;
+    metrics.lq += rho * rho / (1 - rho);
+    metrics.l += rho / (1 - rho);
+  }
+  metrics.wq = metrics.lq / total_gamma;
+  metrics.w = metrics.l / total_gamma;
+
+  return metrics;
+}
+
+QueueMetrics RunHW1(double rho, long long n_customer, uint64_t seed) {
+  queue_simulation::Simulator simulator(1, rho, n_customer);
+  simulator.Reseed(seed, 0);
+  simulator.StartSimulation();
+  while(simulator.GetNumberServiced() < n_customer) simulator.StepSimulate();
+  simulator.SetMetrics();
+
+  return {simulator.GetWq(), simulator.GetLq(), simulator.GetW(), simulator.GetL()};
+}
+
+QueueMetrics RunLanes(double rho, long long n_customer, uint64_t seed) {
+  queue_simulation::LaneSimulator<8> simulator(1, rho, n_customer / 8, seed);
+  simulator.RunSimulation();
+
+  QueueMetrics mean = {0, 0, 0, 0};
+  for(queue_simulation::LaneMetrics& m : simulator.GetMetrics()) {
+    mean.wq += m.wq / 8;
+    mean.lq += m.lq / 8;
+    mean.w += m.w / 8;
+    mean.l += m.l / 8;
+  }
+
+  return mean;
+}
+
+QueueMetrics RunNetwork(queue_network::Network& network, long long n_customer, uint64_t seed,
+                        queue_network::EngineType engine) {
+  queue_network::NetworkMetrics result =
+    queue_network::RunNetworkSimulation(network, n_customer / 100, n_customer, seed, engine);
+
+  // lq of a node is the fraction of its customers who waited, as in tri_q, so
+  // the queue lengths come from the simulated waits by Little's law
+  QueueMetrics metrics = {0, 0, result.r, 0};
+  double elapsed = result.clock - result.first_entry, e_s = 0;
+  for(int i = 0; i < network.GetNNode(); i++) {
+    queue_network::NodeMetrics& node = result.nodes[i];
+    metrics.lq += node.wq * node.n_customer / elapsed;
+    metrics.l += node.w * node.n_customer / elapsed;
+    e_s += node.n_customer * node.e_s;
+  }
+  metrics.wq = result.r - e_s / result.n_customer;
+
+  return metrics;
+}
+
+double GetError(double value, double exact) {
+  return std::fabs(value - exact) / exact;
+}
+
+int main(int argc, char* argv[]) {
+  std::vector<double> rhos = {0.5, 0.7, 0.8, 0.9};
+  std::vector<std::string> engines = {"hw1", "lanes", "lindley", "event"};
+  long long first_customer = 10000;
+  double budget = 1;
+  std::string out = "accuracy.csv";
+  const double kP = 0.4;
+
+  // options come in pairs:
+  //   rho <r1,r2,...>: utilizations of the grid
+  //   engines <hw1,lanes,lindley,event>: engines to run
+  //   customers <n>: smallest run, doubled until a run takes the budget
+  //   budget <seconds>: cpu seconds of the longest run per curve
+  //   out <path>: csv of every run
+  for(int i = 1; i + 1 < argc; i += 2) {
+    std::string option = argv[i], value = argv[i + 1];
+    std::stringstream list(value);
+    std::string item;
+
+    if(option == "rho") {
+      rhos.clear();
+      while(std::getline(list, item, ',')) rhos.push_back(std::stod(item));
+    }
+    else if(option == "engines") {
+      engines.clear();
+      while(std::getline(list, item, ',')) engines.push_back(item);
+    }
+    else if(option == "customers") {
+      first_customer = std::stoll(value);
+    }
+    else if(option == "budget") {
+      budget = std::stod(value);
+    }
+    else if(option == "out") {
+      out = value;
+    }
+  }
+
+  std::vector<BenchPoint> points;
+  uint64_t seed = 1;
+
+  for(std::string& engine : engines) {
+    for(double rho : rhos) {
+      queue_network::Network network = GetTriNetwork(rho, kP);
+      bool is_network = engine == "lindley" || engine == "event";
+      QueueMetrics exact = is_network ? GetJacksonMetrics(network) : GetMM1Metrics(rho);
+
+      for(long long n = first_customer; ; n *= 2) {
+        double start = GetCpuSeconds();
+        QueueMetrics m;
+        if(engine == "hw1") m = RunHW1(rho, n, seed);
+        else if(engine == "lanes") m = RunLanes(rho, n, seed);
+        else if(engine == "lindley") m = RunNetwork(network, n, seed, queue_network::kLindley);
+        else if(engine == "event") m = RunNetwork(network, n, seed, queue_network::kEvent);
+        else throw "UNKNOWN ENGINE";
+        double seconds = GetCpuSeconds() - start;
+        seed++;
+
+        QueueMetrics error = {GetError(m.wq, exact.wq), GetError(m.lq, exact.lq),
+                              GetError(m.w, exact.w), GetError(m.l, exact.l)};
+        points.push_back({engine, rho, n, seconds, m, error});
+
+        if(seconds >= budget) break;
+      }
+    }
+  }
+
+  std::ofstream csv(out);
+  csv << "engine,rho,customers,cpu_seconds,wq,lq,w,l,error_wq,error_lq,error_w,error_l" << std::endl;
+  for(BenchPoint& p : points)
+    csv << p.engine << "," << p.rho << "," << p.n_customer << "," << p.seconds << ","
+        << p.metrics.wq << "," << p.metrics.lq << "," << p.metrics.w << "," << p.metrics.l << ","
+        << p.error.wq << "," << p.error.lq << "," << p.error.w << "," << p.error.l << std::endl;
+
+  // the last point of every curve. error * sqrt(seconds) stays flat while
+  // the error falls like 1 / sqrt(time), lower is more accuracy per second,
+  // and a rising value means a bias the engine cannot average away
+  std::cout << "###Accuracy versus Cost###" << std::endl
+            << std::setw(8) << "engine" << std::setw(6) << "rho" << std::setw(12) << "customers"
+            << std::setw(12) << "seconds" << std::setw(12) << "error Wq" << std::setw(12) << "error L"
+            << std::setw(14) << "err*sqrt(s)" << std::endl;
+  for(size_t i = 0; i < points.size(); i++) {
+    BenchPoint& p = points[i];
+    if(i + 1 < points.size() && points[i + 1].engine == p.engine && points[i + 1].rho == p.rho)
+      continue;
+
+    std::cout << std::setw(8) << p.engine << std::setw(6) << p.rho << std::setw(12) << p.n_customer
+              << std::setw(12) << p.seconds << std::setw(12) << p.error.wq << std::setw(12) << p.error.l
+              << std::setw(14) << p.error.wq * std::sqrt(p.seconds) << std::endl;
+  }
+  std::cout << "every run is in " << out << std::endl;
+
+  return 0;
+}
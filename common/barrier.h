@@ -0,0 +1,37 @@
+#ifndef COMMON_BARRIER_H_
+#define COMMON_BARRIER_H_
+
+#include <atomic>
+#include <thread>
+
+namespace common {
+
+  // reusable barrier for a fixed number of threads. the last thread to arrive
+  // resets the count and bumps the generation the others spin on, and the
+  // release on the generation makes every write before Wait visible after it.
+  class SpinBarrier {
+  public:
+    explicit SpinBarrier(int n_thread) : n_thread_(n_thread), count_(0), generation_(0) {}
+
+    void Wait() {
+      int generation = generation_.load(std::memory_order_acquire);
+
+      if(count_.fetch_add(1, std::memory_order_acq_rel) + 1 == n_thread_) {
+        count_.store(0, std::memory_order_relaxed);
+        generation_.fetch_add(1, std::memory_order_release);
+        return;
+      }
+
+      while(generation_.load(std::memory_order_acquire) == generation)
+        std::this_thread::yield();
+    }
+
+  private:
+    const int n_thread_;
+    alignas(64) std::atomic<int> count_;
+    alignas(64) std::atomic<int> generation_;
+  }; // class SpinBarrier
+
+} // namespace common
+
+#endif // COMMON_BARRIER_H_
@@ -0,0 +1,178 @@
+#ifndef COMMON_CACHE_H_
+#define COMMON_CACHE_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+#include "checkpoint.h"
+#include "shard.h"
+
+namespace common {
+
+  // canonical bytes of everything a result depends on: a model name and
+  // version, the event tables, the counts and the seed, added in a fixed
+  // order as raw values. equal scenarios give equal bytes, so the hash of
+  // the bytes names the result.
+  class ScenarioKey {
+  public:
+    explicit ScenarioKey(const std::string& model) {
+      Add(model);
+    }
+
+    template <class T>
+    void Add(const T& value) {
+      buffer_.Put(value);
+    }
+
+    template <class T>
+    void Add(const std::vector<T>& values) {
+      buffer_.PutVector(values);
+    }
+
+    void Add(const std::string& s) {
+      buffer_.PutVector(std::vector<char>(s.begin(), s.end()));
+    }
+
+    std::string GetBytes() const {
+      CheckpointBuffer buffer = buffer_;
+      return buffer.Finish(0, 0);
+    }
+
+    std::string GetHash() const {
+      std::string bytes = GetBytes();
+      std::stringstream hash;
+      hash << std::hex << std::setfill('0') << std::setw(16) << GetChecksum(bytes.data(), bytes.size());
+      return hash.str();
+    }
+
+  private:
+    CheckpointBuffer buffer_;
+  }; // class ScenarioKey
+
+  // results on disk under dir, one file per scenario hash holding the
+  // scenario bytes and the ranges of replications simulated for it, each with
+  // its PartialResult. replication r of a scenario is always the same run, so
+  // a request for n replications merges a chain of cached ranges covering
+  // [0, m) for the largest m <= n it can, and only runs [m, n), which is
+  // cached as one more range. the answer is always exactly replications
+  // [0, n), whatever earlier requests cached. a file whose scenario bytes
+  // differ (a hash collision) or that does not parse counts as a miss and is
+  // overwritten.
+  class ResultCache {
+  public:
+    static const uint32_t kMagic = 0x45484352; // "RCHE"
+    static const uint32_t kVersion = 2;
+
+    typedef std::function<PartialResult(int64_t, int64_t)> Work;
+
+    // replications [first, first + count) of one run
+    struct Range {
+      int64_t first, count;
+      PartialResult result;
+    }; // struct Range
+
+    explicit ResultCache(const std::string& dir) : dir_(dir), n_cached_(0), n_simulated_(0) {
+      mkdir(dir_.c_str(), 0755);
+    }
+
+    bool Load(const ScenarioKey& key, std::vector<Range>& ranges) {
+      std::string bytes;
+      if(!ReadCheckpointFile(GetPath(key), bytes)) return false;
+
+      CheckpointReader reader;
+      std::vector<char> scenario_bytes;
+      uint64_t n_range;
+      if(!reader.Open(bytes, kMagic, kVersion) || !reader.GetVector(scenario_bytes) || !reader.Get(n_range))
+        return false;
+      if(std::string(scenario_bytes.begin(), scenario_bytes.end()) != key.GetBytes()) return false;
+
+      ranges.clear();
+      for(uint64_t i = 0; i < n_range; i++) {
+        Range range;
+        std::vector<char> partial_bytes;
+        if(!reader.Get(range.first) || !reader.Get(range.count) || !reader.GetVector(partial_bytes)
+           || range.first < 0 || range.count < 1
+           || !range.result.Deserialize(std::string(partial_bytes.begin(), partial_bytes.end())))
+          return false;
+        ranges.push_back(range);
+      }
+      return reader.IsDone();
+    }
+
+    // replaced with a rename, so a reader never sees half a file, and a
+    // failed write leaves the old result in place
+    void Store(const ScenarioKey& key, const std::vector<Range>& ranges) {
+      std::string scenario = key.GetBytes();
+      CheckpointBuffer buffer;
+      buffer.PutVector(std::vector<char>(scenario.begin(), scenario.end()));
+      buffer.Put<uint64_t>(ranges.size());
+      for(const Range& range : ranges) {
+        std::string partial = range.result.Serialize();
+        buffer.Put(range.first);
+        buffer.Put(range.count);
+        buffer.PutVector(std::vector<char>(partial.begin(), partial.end()));
+      }
+      WriteCheckpointFile(GetPath(key), buffer.Finish(kMagic, kVersion));
+    }
+
+    // the result of replications [0, n_replication), running work(first,
+    // count) only for the ones no chain of cached ranges covers
+    PartialResult Run(const ScenarioKey& key, int64_t n_replication, Work work) {
+      std::vector<Range> ranges;
+      if(!Load(key, ranges)) ranges.clear();
+      std::sort(ranges.begin(), ranges.end(),
+                [](const Range& a, const Range& b) { return a.first < b.first; });
+
+      // every end <= n_replication a chain from 0 reaches, with the last range
+      // of the chain. a chain to first only uses ranges that start before it,
+      // so one pass in order of first finds them all
+      std::map<int64_t, int> last_range;
+      last_range[0] = -1;
+      for(size_t i = 0; i < ranges.size(); i++) {
+        int64_t end = ranges[i].first + ranges[i].count;
+        if(last_range.count(ranges[i].first) && end <= n_replication && !last_range.count(end))
+          last_range[end] = i;
+      }
+
+      int64_t n_cached = last_range.rbegin()->first;
+      std::vector<int> chain;
+      for(int64_t end = n_cached; end > 0; end = ranges[last_range[end]].first)
+        chain.push_back(last_range[end]);
+
+      PartialResult result;
+      for(auto i = chain.rbegin(); i != chain.rend(); ++i) result.Merge(ranges[*i].result);
+
+      n_cached_ = n_cached;
+      n_simulated_ = n_replication - n_cached;
+      if(n_simulated_ <= 0) return result;
+
+      PartialResult rest = work(n_cached, n_simulated_);
+      result.Merge(rest);
+      ranges.push_back(Range{n_cached, n_simulated_, rest});
+      Store(key, ranges);
+      return result;
+    }
+
+    // replications of the last Run taken from disk and simulated
+    int64_t GetNCached() { return n_cached_; }
+    int64_t GetNSimulated() { return n_simulated_; }
+
+    std::string GetPath(const ScenarioKey& key) {
+      return dir_ + "/" + key.GetHash() + ".result";
+    }
+
+  private:
+    std::string dir_;
+    int64_t n_cached_, n_simulated_;
+  }; // class ResultCache
+
+} // namespace common
+
+#endif // COMMON_CACHE_H_
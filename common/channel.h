@@ -0,0 +1,74 @@
+#ifndef COMMON_CHANNEL_H_
+#define COMMON_CHANNEL_H_
+
+#include <atomic>
+
+namespace common {
+
+  // unbounded lock free queue between one producer and one consumer thread.
+  // items live in a linked list of chunks: the producer publishes an item by
+  // storing the chunk's size with release and links a new chunk when one is
+  // full, the consumer frees chunks it has read to the end.
+  template <class T, int kChunk = 1024>
+  class SpscChannel {
+  public:
+    SpscChannel() {
+      head_ = tail_ = new Chunk;
+      read_ = tail_size_ = 0;
+    }
+
+    SpscChannel(const SpscChannel&) = delete;
+    SpscChannel& operator=(const SpscChannel&) = delete;
+
+    ~SpscChannel() {
+      while(head_) {
+        Chunk* next = head_->next.load(std::memory_order_relaxed);
+        delete head_;
+        head_ = next;
+      }
+    }
+
+    // producer only
+    void Push(const T& item) {
+      if(tail_size_ == kChunk) {
+        Chunk* chunk = new Chunk;
+        tail_->next.store(chunk, std::memory_order_release);
+        tail_ = chunk;
+        tail_size_ = 0;
+      }
+
+      tail_->items[tail_size_] = item;
+      tail_->size.store(++tail_size_, std::memory_order_release);
+    }
+
+    // consumer only, false when nothing is published yet
+    bool Pop(T& item) {
+      if(read_ == kChunk) {
+        Chunk* next = head_->next.load(std::memory_order_acquire);
+        if(!next) return false;
+        delete head_;
+        head_ = next;
+        read_ = 0;
+      }
+
+      if(read_ == head_->size.load(std::memory_order_acquire)) return false;
+      item = head_->items[read_++];
+      return true;
+    }
+
+  private:
+    struct Chunk {
+      T items[kChunk];
+      std::atomic<int> size{0};
+      std::atomic<Chunk*> next{nullptr};
+    }; // struct Chunk
+
+    alignas(64) Chunk* head_;
+    int read_;
+    alignas(64) Chunk* tail_;
+    int tail_size_;
+  }; // class SpscChannel
+
+} // namespace common
+
+#endif // COMMON_CHANNEL_H_
@@ -0,0 +1,217 @@
+#ifndef COMMON_CHECKPOINT_H_
+#define COMMON_CHECKPOINT_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <type_traits>
+
+#include "random.h"
+
+namespace common {
+
+  // checkpoint layout: magic, version, payload size, payload, fnv-1a checksum
+  // of the payload. all fields are raw little endian values.
+  inline uint64_t GetChecksum(const char* data, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for(size_t i = 0; i < size; i++) {
+      hash ^= (unsigned char)data[i];
+      hash *= 0x100000001b3ULL;
+    }
+    return hash;
+  }
+
+  class CheckpointBuffer {
+  public:
+    template <class T>
+    void Put(const T& value) {
+      static_assert(std::is_trivially_copyable<T>::value, "checkpoint fields must be trivially copyable");
+      payload_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <class T>
+    void PutVector(const std::vector<T>& values) {
+      Put<uint64_t>(values.size());
+      for(const T& v : values) Put(v);
+    }
+
+    void PutRandom(const Random& random) {
+      Put(random.GetState());
+      Put(random.GetIncrement());
+    }
+
+    std::string Finish(uint32_t magic, uint32_t version) {
+      std::string bytes;
+      uint64_t size = payload_.size();
+      uint64_t checksum = GetChecksum(payload_.data(), payload_.size());
+      bytes.append(reinterpret_cast<const char*>(&magic), sizeof(magic));
+      bytes.append(reinterpret_cast<const char*>(&version), sizeof(version));
+      bytes.append(reinterpret_cast<const char*>(&size), sizeof(size));
+      bytes.append(payload_);
+      bytes.append(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+      return bytes;
+    }
+
+  private:
+    std::string payload_;
+  }; // class CheckpointBuffer
+
+  class CheckpointReader {
+  public:
+    // false when the bytes are truncated, corrupt or of another format
+    bool Open(const std::string& bytes, uint32_t magic, uint32_t version) {
+      const size_t kHeader = sizeof(uint32_t) * 2 + sizeof(uint64_t);
+      if(bytes.size() < kHeader + sizeof(uint64_t)) return false;
+
+      uint32_t file_magic, file_version;
+      uint64_t size, checksum;
+      std::memcpy(&file_magic, bytes.data(), sizeof(file_magic));
+      std::memcpy(&file_version, bytes.data() + 4, sizeof(file_version));
+      std::memcpy(&size, bytes.data() + 8, sizeof(size));
+      if(file_magic != magic || file_version != version) return false;
+      if(bytes.size() != kHeader + size + sizeof(checksum)) return false;
+
+      std::memcpy(&checksum, bytes.data() + kHeader + size, sizeof(checksum));
+      if(checksum != GetChecksum(bytes.data() + kHeader, size)) return false;
+
+      payload_ = bytes.substr(kHeader, size);
+      position_ = 0;
+      return true;
+    }
+
+    template <class T>
+    bool Get(T& value) {
+      static_assert(std::is_trivially_copyable<T>::value, "checkpoint fields must be trivially copyable");
+      if(position_ + sizeof(T) > payload_.size()) return false;
+      std::memcpy(&value, payload_.data() + position_, sizeof(T));
+      position_ += sizeof(T);
+      return true;
+    }
+
+    template <class T>
+    bool GetVector(std::vector<T>& values) {
+      uint64_t size;
+      if(!Get(size) || size > (payload_.size() - position_) / sizeof(T)) return false;
+      values.resize(size);
+      for(T& v : values)
+        if(!Get(v)) return false;
+      return true;
+    }
+
+    bool GetRandom(Random& random) {
+      uint64_t state, inc;
+      if(!Get(state) || !Get(inc)) return false;
+      random.SetState(state, inc);
+      return true;
+    }
+
+    bool IsDone() {
+      return position_ == payload_.size();
+    }
+
+  private:
+    std::string payload_;
+    size_t position_ = 0;
+  }; // class CheckpointReader
+
+  inline bool ReadCheckpointFile(const std::string& path, std::string& bytes) {
+    std::ifstream file(path, std::ios_base::binary);
+    if(!file.is_open()) return false;
+
+    std::stringstream ss;
+    ss << file.rdbuf();
+    bytes = ss.str();
+    return true;
+  }
+
+  // writes bytes next to path and renames them over it only once the whole
+  // file is written and closed, so a failed write (a full disk) leaves the
+  // previous file in place
+  inline bool WriteCheckpointFile(const std::string& path, const std::string& bytes) {
+    std::string tmp_path = path + ".tmp";
+    std::ofstream file(tmp_path, std::ios_base::binary | std::ios_base::trunc);
+    file.write(bytes.data(), bytes.size());
+    file.close();
+
+    if(!file.good()) {
+      std::remove(tmp_path.c_str());
+      return false;
+    }
+    return std::rename(tmp_path.c_str(), path.c_str()) == 0;
+  }
+
+  // writes checkpoints on a background thread so the simulation loop only pays
+  // for serializing its state. only the newest pending snapshot is kept, and
+  // files are replaced with a rename so a crash never leaves a torn checkpoint.
+  class CheckpointWriter {
+  public:
+    CheckpointWriter() : has_pending_(false), writing_(false), stop_(false) {}
+
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+    ~CheckpointWriter() {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+      }
+      cv_.notify_all();
+      if(thread_.joinable()) thread_.join();
+    }
+
+    void Submit(std::string path, std::string bytes) {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        path_ = std::move(path);
+        pending_ = std::move(bytes);
+        has_pending_ = true;
+        if(!thread_.joinable()) thread_ = std::thread(&CheckpointWriter::Run, this);
+      }
+      cv_.notify_all();
+    }
+
+    // blocks until every submitted checkpoint is on disk
+    void Flush() {
+      std::unique_lock<std::mutex> lock(mutex_);
+      done_cv_.wait(lock, [this] { return !has_pending_ && !writing_; });
+    }
+
+  private:
+    void Run() {
+      std::unique_lock<std::mutex> lock(mutex_);
+
+      while(true) {
+        cv_.wait(lock, [this] { return has_pending_ || stop_; });
+        if(!has_pending_) return;
+
+        std::string path = std::move(path_), bytes = std::move(pending_);
+        has_pending_ = false;
+        writing_ = true;
+        lock.unlock();
+
+        // a failed write keeps the last good checkpoint
+        WriteCheckpointFile(path, bytes);
+
+        lock.lock();
+        writing_ = false;
+        done_cv_.notify_all();
+      }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cv_, done_cv_;
+    std::string path_, pending_;
+    bool has_pending_, writing_, stop_;
+    std::thread thread_;
+  }; // class CheckpointWriter
+
+} // namespace common
+
+#endif // COMMON_CHECKPOINT_H_
@@ -0,0 +1,99 @@
+#ifndef COMMON_EXACT_H_
+#define COMMON_EXACT_H_
+
+#include <cmath>
+#include <cstddef>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace common {
+
+  // above this many support points exact evaluation is not worth it and the
+  // caller should simulate instead
+  const size_t kMaxExactSupport = 1 << 20;
+
+  // finite distribution as value -> probability, equal values are merged
+  template <class T>
+  class Distribution {
+  public:
+    void Add(T value, double p) {
+      if(p != 0) points_[value] += p;
+    }
+
+    // adds weight times every point of other, for mixtures
+    void AddMixture(const Distribution<T>& other, double weight) {
+      for(const auto& point : other.points_) Add(point.first, weight * point.second);
+    }
+
+    const std::map<T, double>& GetPoints() const { return points_; }
+    size_t GetSize() const { return points_.size(); }
+
+    template <class F>
+    double Expect(F f) const {
+      double e = 0;
+      for(const auto& point : points_) e += f(point.first) * point.second;
+      return e;
+    }
+
+    double GetTotalProbability() const {
+      return Expect([](T) { return 1.0; });
+    }
+
+    double GetMean() const {
+      return Expect([](T x) { return (double)x; });
+    }
+
+    double GetVariance() const {
+      double mean = GetMean();
+      return Expect([mean](T x) { return ((double)x - mean) * ((double)x - mean); });
+    }
+
+    template <class F>
+    Distribution<decltype(std::declval<F>()(std::declval<T>()))> Map(F f) const {
+      Distribution<decltype(std::declval<F>()(std::declval<T>()))> mapped;
+      for(const auto& point : points_) mapped.Add(f(point.first), point.second);
+      return mapped;
+    }
+
+    // distribution of the sum of independent draws from this and other
+    Distribution<T> GetSum(const Distribution<T>& other) const {
+      Distribution<T> sum;
+      for(const auto& a : points_)
+        for(const auto& b : other.points_)
+          sum.Add(a.first + b.first, a.second * b.second);
+      return sum;
+    }
+
+    // distribution of the minimum of n independent draws, from the survival
+    // function: P(min >= x) = P(X >= x)^n
+    Distribution<T> GetMin(int n) const {
+      Distribution<T> min;
+      double survival = GetTotalProbability();
+
+      for(const auto& point : points_) {
+        double next = survival - point.second;
+        min.Add(point.first, std::pow(survival, n) - std::pow(next > 0 ? next : 0, n));
+        survival = next;
+      }
+      return min;
+    }
+
+    // support size of the sum of n independent draws, before merging
+    double GetSumSupport(int n) const {
+      return std::pow((double)points_.size(), n);
+    }
+
+  private:
+    std::map<T, double> points_;
+  }; // class Distribution
+
+  // z score of a simulated mean against the exact one
+  inline double GetZScore(double simulated, double exact, double variance, double n) {
+    double se = std::sqrt(variance / n);
+    return se > 0 ? (simulated - exact) / se : 0;
+  }
+
+} // namespace common
+
+#endif // COMMON_EXACT_H_
@@ -0,0 +1,94 @@
+#ifndef COMMON_HISTOGRAM_H_
+#define COMMON_HISTOGRAM_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace common {
+
+  // time spent at each value of a count like the queue length. values below
+  // kDense have a bin each, above that every octave is cut into kSub equal
+  // bins, so the relative bin width stays under 1 / kSub however long the
+  // queue gets. histograms of replications Merge by adding their bins.
+  class TimeHistogram {
+  public:
+    static const int kDenseBits = 6, kSubBits = 3;
+    static const uint64_t kDense = 1 << kDenseBits, kSub = 1 << kSubBits;
+
+    TimeHistogram() : weights_(kDense, 0), total_(0) {}
+
+    void Add(uint64_t value, double time) {
+      size_t bin = GetBin(value);
+      if(bin >= weights_.size()) weights_.resize(bin + 1, 0);
+      weights_[bin] += time;
+      total_ += time;
+    }
+
+    void Merge(const TimeHistogram& other) {
+      if(other.weights_.size() > weights_.size()) weights_.resize(other.weights_.size(), 0);
+      for(size_t i = 0; i < other.weights_.size(); i++) weights_[i] += other.weights_[i];
+      total_ += other.total_;
+    }
+
+    static size_t GetBin(uint64_t value) {
+      if(value < kDense) return value;
+
+      int msb = 63 - __builtin_clzll(value);
+      return kDense + (msb - kDenseBits) * kSub + ((value >> (msb - kSubBits)) & (kSub - 1));
+    }
+
+    // smallest value of a bin, the bin holds values up to GetLower(bin + 1)
+    static uint64_t GetLower(size_t bin) {
+      if(bin < kDense) return bin;
+
+      size_t octave = (bin - kDense) / kSub, sub = (bin - kDense) % kSub;
+      return (kSub + sub) << (octave + kDenseBits - kSubBits);
+    }
+
+    size_t GetNBin() const { return weights_.size(); }
+    double GetWeight(size_t bin) const { return bin < weights_.size() ? weights_[bin] : 0; }
+    double GetTotal() const { return total_; }
+
+    // fraction of the time at value, exact below kDense
+    double GetProbability(uint64_t value) const {
+      return total_ > 0 ? GetWeight(GetBin(value)) / total_ : 0;
+    }
+
+    // fraction of the time at value or above, exact on bin boundaries
+    double GetTail(uint64_t value) const {
+      if(total_ <= 0) return 0;
+
+      double tail = 0;
+      for(size_t i = GetBin(value); i < weights_.size(); i++) tail += weights_[i];
+      return tail / total_;
+    }
+
+    // smallest v with at least a fraction q of the time at v or below,
+    // rounded up to the last value of its bin
+    uint64_t GetQuantile(double q) const {
+      double below = 0;
+      for(size_t i = 0; i < weights_.size(); i++) {
+        below += weights_[i];
+        if(below >= q * total_) return GetLower(i + 1) - 1;
+      }
+      return GetLower(weights_.size()) - 1;
+    }
+
+    const std::vector<double>& GetWeights() const { return weights_; }
+
+    void SetWeights(const std::vector<double>& weights) {
+      weights_ = weights;
+      if(weights_.size() < kDense) weights_.resize(kDense, 0);
+      total_ = 0;
+      for(double w : weights_) total_ += w;
+    }
+
+  private:
+    std::vector<double> weights_;
+    double total_;
+  }; // class TimeHistogram
+
+} // namespace common
+
+#endif // COMMON_HISTOGRAM_H_
@@ -0,0 +1,187 @@
+#ifndef COMMON_PERF_H_
+#define COMMON_PERF_H_
+
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace common {
+
+  enum PerfCounter { kCycles, kInstructions, kBranchMisses, kCacheMisses, kNPerfCounter };
+
+  struct PerfSample {
+    double seconds;
+    uint64_t counts[kNPerfCounter];
+  }; // struct PerfSample
+
+  // user space hardware counters of the calling thread from perf_event_open.
+  // a counter the kernel refuses (perf_event_paranoid, containers, virtual
+  // machines, other systems) stays closed and reads as zero, with none of
+  // them only the wall clock is left.
+  class PerfCounters {
+  public:
+    PerfCounters() {
+      start_ = std::chrono::steady_clock::now();
+
+      for(int c = 0; c < kNPerfCounter; c++) {
+        fd_[c] = -1;
+#ifdef __linux__
+        const uint64_t kConfig[kNPerfCounter] = {
+          PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+          PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_HW_CACHE_MISSES
+        };
+        perf_event_attr attr = perf_event_attr();
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = kConfig[c];
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd_[c] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+      }
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    ~PerfCounters() {
+#ifdef __linux__
+      for(int c = 0; c < kNPerfCounter; c++)
+        if(fd_[c] >= 0) close(fd_[c]);
+#endif
+    }
+
+    bool IsAvailable(int counter) const {
+      return fd_[counter] >= 0;
+    }
+
+    // totals since construction
+    PerfSample Read() const {
+      PerfSample sample;
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_;
+      sample.seconds = elapsed.count();
+
+      for(int c = 0; c < kNPerfCounter; c++) {
+        sample.counts[c] = 0;
+#ifdef __linux__
+        if(fd_[c] >= 0 && read(fd_[c], &sample.counts[c], sizeof(uint64_t)) != sizeof(uint64_t))
+          sample.counts[c] = 0;
+#endif
+      }
+
+      return sample;
+    }
+
+  private:
+    std::chrono::steady_clock::time_point start_;
+    int fd_[kNPerfCounter];
+  }; // class PerfCounters
+
+  // counter deltas over named phases of a run. Begin ends the running phase,
+  // a phase that comes again adds to its totals, and AddEvents gives the
+  // events a phase handled for the per event costs.
+  class PhaseProfiler {
+  public:
+    PhaseProfiler() : current_(-1) {}
+
+    void Begin(std::string name) {
+      End();
+
+      current_ = -1;
+      for(size_t i = 0; i < phases_.size(); i++)
+        if(phases_[i].name == name) current_ = i;
+      if(current_ < 0) {
+        phases_.push_back(Phase{name, PerfSample(), 0});
+        current_ = phases_.size() - 1;
+      }
+
+      start_ = counters_.Read();
+    }
+
+    void End() {
+      if(current_ < 0) return;
+
+      PerfSample end = counters_.Read();
+      Phase& phase = phases_[current_];
+      phase.total.seconds += end.seconds - start_.seconds;
+      for(int c = 0; c < kNPerfCounter; c++)
+        phase.total.counts[c] += end.counts[c] - start_.counts[c];
+      current_ = -1;
+    }
+
+    void AddEvents(std::string name, unsigned long long n_event) {
+      for(Phase& phase : phases_)
+        if(phase.name == name) phase.n_event += n_event;
+    }
+
+    std::string GetReport() {
+      End();
+      bool counted = counters_.IsAvailable(kCycles);
+
+      std::stringstream report;
+      report << "PROFILE";
+      if(!counted) report << " (no hardware counters, wall clock only)";
+      report << std::endl << std::left << std::setw(24) << "phase" << std::right
+             << std::setw(12) << "seconds";
+      if(counted)
+        report << std::setw(16) << "cycles" << std::setw(8) << "IPC" << std::setw(14) << "branch miss"
+               << std::setw(14) << "cache miss";
+      report << std::setw(14) << "events" << std::setw(12) << "ns/event";
+      if(counted)
+        report << std::setw(14) << "cycles/event" << std::setw(14) << "br miss/event";
+      report << std::endl;
+
+      for(Phase& phase : phases_) {
+        const uint64_t* counts = phase.total.counts;
+        report << std::left << std::setw(24) << phase.name << std::right
+               << std::setw(12) << phase.total.seconds;
+        if(counted)
+          report << std::setw(16) << counts[kCycles]
+                 << std::setw(8) << std::setprecision(3)
+                 << (counts[kCycles] ? (double)counts[kInstructions] / counts[kCycles] : 0)
+                 << std::setprecision(6)
+                 << std::setw(14) << GetCount(counts, kBranchMisses)
+                 << std::setw(14) << GetCount(counts, kCacheMisses);
+
+        if(phase.n_event) {
+          report << std::setw(14) << phase.n_event
+                 << std::setw(12) << phase.total.seconds * 1e9 / phase.n_event;
+          if(counted)
+            report << std::setw(14) << (double)counts[kCycles] / phase.n_event
+                   << std::setw(14) << (double)counts[kBranchMisses] / phase.n_event;
+        }
+        report << std::endl;
+      }
+
+      return report.str();
+    }
+
+  private:
+    struct Phase {
+      std::string name;
+      PerfSample total;
+      unsigned long long n_event;
+    }; // struct Phase
+
+    std::string GetCount(const uint64_t* counts, int counter) {
+      return counters_.IsAvailable(counter) ? std::to_string(counts[counter]) : "-";
+    }
+
+    PerfCounters counters_;
+    std::vector<Phase> phases_;
+    int current_;
+    PerfSample start_;
+  }; // class PhaseProfiler
+
+} // namespace common
+
+#endif // COMMON_PERF_H_
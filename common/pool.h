@@ -0,0 +1,227 @@
+#ifndef COMMON_POOL_H_
+#define COMMON_POOL_H_
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace common {
+
+  // size classed arena for small objects. blocks of 16, 32, ... 4096 bytes
+  // are carved from 64 KB slabs and freed blocks go to a free list per
+  // class, so once a run has reached its peak footprint it allocates nothing
+  // from the heap. Reset returns every block at once and keeps the slabs for
+  // the next replication. one arena belongs to one thread.
+  class Arena {
+  public:
+    static const size_t kMinBlock = 16, kMaxBlock = 4096, kSlab = 1 << 16;
+    static const int kNClass = 9;
+
+    Arena() {
+      Reset();
+    }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    ~Arena() {
+      for(char* slab : slabs_) delete[] slab;
+    }
+
+    void* Allocate(size_t size) {
+      if(size > kMaxBlock) return ::operator new(size);
+
+      int c = GetClass(size);
+      if(free_[c]) {
+        Block* block = free_[c];
+        free_[c] = block->next;
+        return block;
+      }
+
+      size_t block_size = kMinBlock << c;
+      if(slab_ == slabs_.size() || offset_ + block_size > kSlab) {
+        if(slab_ < slabs_.size()) slab_++;
+        if(slab_ == slabs_.size()) slabs_.push_back(new char[kSlab]);
+        offset_ = 0;
+      }
+
+      void* p = slabs_[slab_] + offset_;
+      offset_ += block_size;
+      return p;
+    }
+
+    // size must be the one given to Allocate
+    void Free(void* p, size_t size) {
+      if(!p) return;
+      if(size > kMaxBlock) {
+        ::operator delete(p);
+        return;
+      }
+
+      int c = GetClass(size);
+      Block* block = static_cast<Block*>(p);
+      block->next = free_[c];
+      free_[c] = block;
+    }
+
+    // every block handed out is invalid afterwards
+    void Reset() {
+      for(int c = 0; c < kNClass; c++) free_[c] = nullptr;
+      slab_ = 0;
+      offset_ = 0;
+    }
+
+    // slabs taken from the heap so far
+    size_t GetNSlab() const {
+      return slabs_.size();
+    }
+
+  private:
+    struct Block {
+      Block* next;
+    }; // struct Block
+
+    static int GetClass(size_t size) {
+      int c = 0;
+      while((kMinBlock << c) < size) c++;
+      return c;
+    }
+
+    Block* free_[kNClass];
+    std::vector<char*> slabs_;
+    size_t slab_, offset_;
+  }; // class Arena
+
+  // the calling thread's arena
+  inline Arena& GetThreadArena() {
+    thread_local Arena arena;
+    return arena;
+  }
+
+  // FIFO in a linked list of fixed size chunks from an arena. a drained chunk
+  // is kept as the spare for the next push instead of going back, so a queue
+  // that moves around a steady length touches the arena only when it grows
+  // past its longest length so far.
+  template <class T, int kChunk = (1024 - sizeof(void*)) / sizeof(T)>
+  class ChunkQueue {
+  public:
+    explicit ChunkQueue(Arena* arena = &GetThreadArena()) : arena_(arena) {
+      head_ = tail_ = spare_ = nullptr;
+      read_ = write_ = 0;
+      size_ = 0;
+    }
+
+    ChunkQueue(const ChunkQueue& other) : ChunkQueue(other.arena_) {
+      for(Chunk* c = other.head_; c; c = c->next) {
+        int begin = c == other.head_ ? other.read_ : 0;
+        int end = c == other.tail_ ? other.write_ : kChunk;
+        for(int i = begin; i < end; i++) push_back(c->items[i]);
+      }
+    }
+
+    ChunkQueue& operator=(ChunkQueue other) {
+      std::swap(arena_, other.arena_);
+      std::swap(head_, other.head_);
+      std::swap(tail_, other.tail_);
+      std::swap(spare_, other.spare_);
+      std::swap(read_, other.read_);
+      std::swap(write_, other.write_);
+      std::swap(size_, other.size_);
+      return *this;
+    }
+
+    ~ChunkQueue() {
+      clear();
+      Release(spare_);
+    }
+
+    void push_back(const T& item) {
+      if(!tail_ || write_ == kChunk) {
+        Chunk* chunk = spare_ ? spare_ : Take();
+        spare_ = nullptr;
+        chunk->next = nullptr;
+        if(tail_) tail_->next = chunk;
+        else head_ = chunk;
+        tail_ = chunk;
+        write_ = 0;
+      }
+
+      tail_->items[write_++] = item;
+      size_++;
+    }
+
+    T& front() {
+      return head_->items[read_];
+    }
+
+    void pop_front() {
+      read_++;
+      size_--;
+
+      if(read_ == kChunk || size_ == 0) {
+        Chunk* chunk = head_;
+        head_ = chunk->next;
+        if(!head_) tail_ = nullptr;
+        read_ = 0;
+        if(size_ == 0) write_ = 0;
+
+        if(spare_) Release(chunk);
+        else spare_ = chunk;
+      }
+    }
+
+    bool empty() const {
+      return size_ == 0;
+    }
+
+    size_t size() const {
+      return size_;
+    }
+
+    void clear() {
+      while(head_) {
+        Chunk* next = head_->next;
+        Release(head_);
+        head_ = next;
+      }
+      tail_ = nullptr;
+      read_ = write_ = 0;
+      size_ = 0;
+    }
+
+    // front to back
+    template <class F>
+    void ForEach(F f) const {
+      for(Chunk* c = head_; c; c = c->next) {
+        int begin = c == head_ ? read_ : 0;
+        int end = c == tail_ ? write_ : kChunk;
+        for(int i = begin; i < end; i++) f(c->items[i]);
+      }
+    }
+
+  private:
+    struct Chunk {
+      T items[kChunk];
+      Chunk* next;
+    }; // struct Chunk
+
+    Chunk* Take() {
+      return new (arena_->Allocate(sizeof(Chunk))) Chunk;
+    }
+
+    void Release(Chunk* chunk) {
+      if(!chunk) return;
+      chunk->~Chunk();
+      arena_->Free(chunk, sizeof(Chunk));
+    }
+
+    Arena* arena_;
+    Chunk *head_, *tail_, *spare_;
+    int read_, write_;
+    size_t size_;
+  }; // class ChunkQueue
+
+} // namespace common
+
+#endif // COMMON_POOL_H_
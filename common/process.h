@@ -0,0 +1,209 @@
+#ifndef COMMON_PROCESS_H_
+#define COMMON_PROCESS_H_
+
+// process interaction on top of a pending event set, needs -std=c++20
+#include <algorithm>
+#include <coroutine>
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "pool.h"
+
+namespace common {
+
+  // a process is a coroutine that co_awaits Scheduler::Delay and
+  // Resource::Acquire. it does not start before the scheduler resumes it and
+  // its frame comes from the thread's arena and goes back when it returns.
+  class Process {
+  public:
+    struct promise_type {
+      Process get_return_object() {
+        return Process(std::coroutine_handle<promise_type>::from_promise(*this));
+      }
+
+      std::suspend_always initial_suspend() noexcept { return {}; }
+      std::suspend_never final_suspend() noexcept { return {}; }
+      void return_void() {}
+      void unhandled_exception() { throw; }
+
+      static void* operator new(size_t size) {
+        return GetThreadArena().Allocate(size);
+      }
+
+      static void operator delete(void* p, size_t size) {
+        GetThreadArena().Free(p, size);
+      }
+    }; // struct promise_type
+
+    Process(Process&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+    Process(const Process&) = delete;
+    Process& operator=(const Process&) = delete;
+
+    // a process that was never spawned
+    ~Process() {
+      if(handle_) handle_.destroy();
+    }
+
+    std::coroutine_handle<> Release() {
+      return std::exchange(handle_, nullptr);
+    }
+
+  private:
+    explicit Process(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+    std::coroutine_handle<promise_type> handle_;
+  }; // class Process
+
+  // resumes suspended processes in time order, first scheduled first on ties
+  class Scheduler {
+  public:
+    Scheduler() {
+      clock_ = 0;
+      n_scheduled_ = n_resume_ = 0;
+      stop_ = false;
+    }
+
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    ~Scheduler() {
+      for(Pending& p : events_) p.handle.destroy();
+    }
+
+    struct DelayAwaiter {
+      Scheduler& scheduler;
+      double delay;
+
+      bool await_ready() const noexcept { return false; }
+      void await_suspend(std::coroutine_handle<> handle) {
+        scheduler.Schedule(handle, scheduler.clock_ + delay);
+      }
+      void await_resume() const noexcept {}
+    }; // struct DelayAwaiter
+
+    DelayAwaiter Delay(double delay) {
+      return DelayAwaiter{*this, delay};
+    }
+
+    // starts the process at the current clock
+    void Spawn(Process process) {
+      Schedule(process.Release(), clock_);
+    }
+
+    void Schedule(std::coroutine_handle<> handle, double time) {
+      events_.push_back({time, n_scheduled_++, handle});
+      std::push_heap(events_.begin(), events_.end(), IsLater);
+    }
+
+    // until no process is pending, the next one is after end or Stop is called
+    void Run(double end = std::numeric_limits<double>::infinity()) {
+      stop_ = false;
+
+      while(!events_.empty() && !stop_) {
+        if(events_.front().time > end) break;
+
+        std::pop_heap(events_.begin(), events_.end(), IsLater);
+        Pending next = events_.back();
+        events_.pop_back();
+
+        clock_ = next.time;
+        n_resume_++;
+        next.handle.resume();
+      }
+    }
+
+    void Stop() {
+      stop_ = true;
+    }
+
+    double GetClock() const {
+      return clock_;
+    }
+
+    unsigned long long GetNResume() const {
+      return n_resume_;
+    }
+
+  private:
+    struct Pending {
+      double time;
+      unsigned long long order;
+      std::coroutine_handle<> handle;
+    }; // struct Pending
+
+    static bool IsLater(const Pending& a, const Pending& b) {
+      return a.time > b.time || (a.time == b.time && a.order > b.order);
+    }
+
+    std::vector<Pending> events_;
+    double clock_;
+    unsigned long long n_scheduled_, n_resume_;
+    bool stop_;
+  }; // class Scheduler
+
+  // capacity identical servers with one FIFO line. Release hands the server
+  // straight to the first waiting process, which resumes at the same time.
+  class Resource {
+  public:
+    Resource(Scheduler& scheduler, int capacity)
+      : scheduler_(scheduler), capacity_(capacity) {
+      n_busy_ = 0;
+    }
+
+    Resource(const Resource&) = delete;
+    Resource& operator=(const Resource&) = delete;
+
+    ~Resource() {
+      while(!waiting_.empty()) {
+        waiting_.front().destroy();
+        waiting_.pop_front();
+      }
+    }
+
+    struct AcquireAwaiter {
+      Resource& resource;
+
+      bool await_ready() noexcept {
+        if(resource.n_busy_ == resource.capacity_) return false;
+        resource.n_busy_++;
+        return true;
+      }
+      void await_suspend(std::coroutine_handle<> handle) {
+        resource.waiting_.push_back(handle);
+      }
+      void await_resume() const noexcept {}
+    }; // struct AcquireAwaiter
+
+    AcquireAwaiter Acquire() {
+      return AcquireAwaiter{*this};
+    }
+
+    void Release() {
+      if(waiting_.empty()) {
+        n_busy_--;
+        return;
+      }
+
+      scheduler_.Schedule(waiting_.front(), scheduler_.GetClock());
+      waiting_.pop_front();
+    }
+
+    int GetNBusy() const {
+      return n_busy_;
+    }
+
+    size_t GetNWaiting() const {
+      return waiting_.size();
+    }
+
+  private:
+    Scheduler& scheduler_;
+    int capacity_, n_busy_;
+    ChunkQueue<std::coroutine_handle<>> waiting_;
+  }; // class Resource
+
+} // namespace common
+
+#endif // COMMON_PROCESS_H_
@@ -0,0 +1,198 @@
+#ifndef COMMON_PROGRESS_H_
+#define COMMON_PROGRESS_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <condition_variable>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace common {
+
+  // a counter or gauge with exactly one writing thread. the writer only does
+  // relaxed loads and stores on its own cache line, readers never write.
+  class alignas(64) ProgressValue {
+  public:
+    ProgressValue(std::string name, bool is_counter)
+      : name_(name), is_counter_(is_counter), count_(0), value_(0) {}
+
+    void Add(uint64_t n) {
+      count_.store(count_.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    void SetCount(uint64_t n) {
+      count_.store(n, std::memory_order_relaxed);
+    }
+
+    void Set(double value) {
+      value_.store(value, std::memory_order_relaxed);
+    }
+
+    const std::string& GetName() const { return name_; }
+    bool IsCounter() const { return is_counter_; }
+    uint64_t GetCount() const { return count_.load(std::memory_order_relaxed); }
+    double GetValue() const { return value_.load(std::memory_order_relaxed); }
+
+  private:
+    std::string name_;
+    bool is_counter_;
+    std::atomic<uint64_t> count_;
+    std::atomic<double> value_;
+  }; // class ProgressValue
+
+  class ProgressRegistry {
+  public:
+    // the returned pointer stays valid for the lifetime of the registry
+    ProgressValue* AddCounter(std::string name) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      values_.emplace_back(name, true);
+      return &values_.back();
+    }
+
+    ProgressValue* AddGauge(std::string name) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      values_.emplace_back(name, false);
+      return &values_.back();
+    }
+
+    // one json object per line, counters also get a per second rate since the
+    // previous snapshot
+    std::string GetSnapshot() {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto now = std::chrono::steady_clock::now();
+      double elapsed = std::chrono::duration<double>(now - start_).count();
+      double interval = std::chrono::duration<double>(now - last_snapshot_).count();
+      last_snapshot_ = now;
+
+      std::stringstream ss;
+      ss << std::setprecision(10) << "{\"elapsed\":" << elapsed;
+
+      previous_counts_.resize(values_.size(), 0);
+      for(size_t i = 0; i < values_.size(); i++) {
+        const ProgressValue& v = values_[i];
+        if(v.IsCounter()) {
+          uint64_t count = v.GetCount();
+          double rate = interval > 0 ? (count - previous_counts_[i]) / interval : 0;
+          previous_counts_[i] = count;
+          ss << ",\"" << v.GetName() << "\":" << count
+             << ",\"" << v.GetName() << "_per_sec\":" << rate;
+        }
+        else {
+          ss << ",\"" << v.GetName() << "\":" << v.GetValue();
+        }
+      }
+      ss << "}";
+
+      return ss.str();
+    }
+
+  private:
+    std::mutex mutex_;
+    std::deque<ProgressValue> values_;
+    std::vector<uint64_t> previous_counts_;
+    std::chrono::steady_clock::time_point start_ = std::chrono::steady_clock::now(),
+      last_snapshot_ = start_;
+  }; // class ProgressRegistry
+
+  // publishes registry snapshots from its own thread. the target is "-" for
+  // stderr, "unix:<path>" for a unix stream socket, or a file path.
+  class ProgressSampler {
+  public:
+    ProgressSampler(ProgressRegistry& registry, std::string target, int interval_ms)
+      : registry_(registry), target_(target), interval_ms_(interval_ms), socket_(-1), stop_(false) {}
+
+    ProgressSampler(const ProgressSampler&) = delete;
+    ProgressSampler& operator=(const ProgressSampler&) = delete;
+
+    ~ProgressSampler() {
+      Stop();
+    }
+
+    void Start() {
+      if(target_.compare(0, 5, "unix:") == 0) {
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        std::string path = target_.substr(5);
+        path.copy(address.sun_path, sizeof(address.sun_path) - 1);
+
+        socket_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if(socket_ >= 0 && ::connect(socket_, (sockaddr*)&address, sizeof(address)) != 0) {
+          ::close(socket_);
+          socket_ = -1;
+        }
+        if(socket_ < 0) std::cerr << "progress socket unavailable: " << path << std::endl;
+      }
+      else if(target_ != "-") {
+        file_.open(target_, std::ios_base::app);
+      }
+
+      thread_ = std::thread(&ProgressSampler::Run, this);
+    }
+
+    // stops the sampler thread after publishing a last snapshot
+    void Stop() {
+      if(!thread_.joinable()) return;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+      }
+      cv_.notify_all();
+      thread_.join();
+
+      if(socket_ >= 0) ::close(socket_);
+      socket_ = -1;
+      file_.close();
+    }
+
+  private:
+    void Run() {
+      std::unique_lock<std::mutex> lock(mutex_);
+      bool stop = false;
+
+      while(!stop) {
+        stop = cv_.wait_for(lock, std::chrono::milliseconds(interval_ms_), [this] { return stop_; });
+        Publish(registry_.GetSnapshot());
+      }
+    }
+
+    void Publish(const std::string& snapshot) {
+      if(socket_ >= 0) {
+        std::string line = snapshot + "\n";
+        if(::send(socket_, line.data(), line.size(), MSG_NOSIGNAL) < 0) {
+          ::close(socket_);
+          socket_ = -1;
+        }
+      }
+      else if(file_.is_open()) {
+        file_ << snapshot << std::endl;
+      }
+      else if(target_ == "-") {
+        std::cerr << snapshot << std::endl;
+      }
+    }
+
+    ProgressRegistry& registry_;
+    std::string target_;
+    int interval_ms_, socket_;
+    std::ofstream file_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_;
+    std::thread thread_;
+  }; // class ProgressSampler
+
+} // namespace common
+
+#endif // COMMON_PROGRESS_H_
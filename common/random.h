@@ -0,0 +1,114 @@
+#ifndef COMMON_RANDOM_H_
+#define COMMON_RANDOM_H_
+
+#include <cstdint>
+
+namespace common {
+
+  // pcg32 generator (O'Neill, pcg-random.org). the whole state is two words,
+  // so it can be written to checkpoints and copied into clones, and every
+  // stream id gives an independent sequence for the same seed.
+  class Random {
+  public:
+    static const uint32_t kMax = 0xffffffffu;
+
+    Random(uint64_t seed = 0x853c49e6748fea9bULL, uint64_t stream = 0xda3e39cb94b95bdbULL) {
+      Seed(seed, stream);
+    }
+
+    void Seed(uint64_t seed, uint64_t stream) {
+      state_ = 0;
+      inc_ = (stream << 1u) | 1u;
+      Next();
+      state_ += seed;
+      Next();
+    }
+
+    uint32_t Next() {
+      uint64_t old = state_;
+      state_ = old * kMultiplier + inc_;
+      uint32_t xorshifted = ((old >> 18u) ^ old) >> 27u;
+      uint32_t rot = old >> 59u;
+      return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+    }
+
+    // uniform on (0, 1]
+    float GetUniform() {
+      uint32_t r;
+      do {
+        r = Next();
+      } while (r == 0);
+
+      return r / (float)kMax;
+    }
+
+    // jumps delta draws ahead in O(log delta)
+    void Advance(uint64_t delta) {
+      uint64_t cur_mult = kMultiplier, cur_plus = inc_;
+      uint64_t acc_mult = 1, acc_plus = 0;
+
+      while(delta > 0) {
+        if(delta & 1) {
+          acc_mult *= cur_mult;
+          acc_plus = acc_plus * cur_mult + cur_plus;
+        }
+        cur_plus = (cur_mult + 1) * cur_plus;
+        cur_mult *= cur_mult;
+        delta /= 2;
+      }
+
+      state_ = acc_mult * state_ + acc_plus;
+    }
+
+    uint64_t GetState() const { return state_; }
+    uint64_t GetIncrement() const { return inc_; }
+
+    void SetState(uint64_t state, uint64_t inc) {
+      state_ = state;
+      inc_ = inc;
+    }
+
+  private:
+    static const uint64_t kMultiplier = 6364136223846793005ULL;
+    uint64_t state_, inc_;
+  }; // class Random
+
+  // kLanes pcg32 streams stepped together, so filling a buffer is a loop over
+  // independent lanes that the compiler can vectorize. stream s owns the pcg32
+  // streams [s * kLanes, (s + 1) * kLanes), so two streams share no lane
+  template <int kLanes>
+  class RandomLanes {
+  public:
+    RandomLanes(uint64_t seed = 0x853c49e6748fea9bULL, uint64_t stream = 0xda3e39cb94b95bdbULL) {
+      Seed(seed, stream);
+    }
+
+    void Seed(uint64_t seed, uint64_t stream) {
+      for(int l = 0; l < kLanes; l++) {
+        Random random(seed, stream * kLanes + l);
+        state_[l] = random.GetState();
+        inc_[l] = random.GetIncrement();
+      }
+    }
+
+    // fills out[0, n) with n rounded up to a multiple of kLanes
+    void Fill(uint32_t* out, int n) {
+      for(int i = 0; i < n; i += kLanes) {
+        for(int l = 0; l < kLanes; l++) {
+          uint64_t old = state_[l];
+          state_[l] = old * kMultiplier + inc_[l];
+          uint32_t xorshifted = ((old >> 18u) ^ old) >> 27u;
+          uint32_t rot = old >> 59u;
+          out[i + l] = (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+        }
+      }
+    }
+
+  private:
+    static const uint64_t kMultiplier = 6364136223846793005ULL;
+    uint64_t state_[kLanes], inc_[kLanes];
+  }; // class RandomLanes
+
+} // namespace common
+
+#endif // COMMON_RANDOM_H_
@@ -0,0 +1,121 @@
+#ifndef COMMON_SCENARIO_H_
+#define COMMON_SCENARIO_H_
+
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace common {
+
+  // one line of a scenario file: a model name, then key value pairs as the
+  // options of the model's main take them, lists comma separated, e.g.
+  //   hw1 name erlang_08 mu 0.8 service erlang:3 replications 16
+  // a missing key gets the value main would use. the keys no Get asked for
+  // are left in GetUnused, so a misspelt key is reported instead of quietly
+  // running the default.
+  class Scenario {
+  public:
+    explicit Scenario(const std::string& model = "", int line = 0) : model_(model), line_(line) {}
+
+    void Set(const std::string& key, const std::string& value) {
+      values_[key] = value;
+    }
+
+    // the keys of defaults this scenario does not set itself
+    void SetDefaults(const Scenario& defaults) {
+      for(const auto& entry : defaults.values_) values_.insert(entry);
+    }
+
+    const std::string& GetModel() const { return model_; }
+    int GetLine() const { return line_; }
+
+    // the name key, or the model and line
+    std::string GetName() {
+      return Get<std::string>("name", model_ + ":" + std::to_string(line_));
+    }
+
+    template <class T>
+    T Get(const std::string& key, const T& otherwise) {
+      auto value = values_.find(key);
+      if(value == values_.end()) return otherwise;
+
+      used_.insert(key);
+      return Parse<T>(value->second);
+    }
+
+    template <class T>
+    std::vector<T> GetList(const std::string& key, const std::vector<T>& otherwise) {
+      auto value = values_.find(key);
+      if(value == values_.end()) return otherwise;
+
+      used_.insert(key);
+      std::vector<T> list;
+      std::stringstream items(value->second);
+      std::string item;
+      while(std::getline(items, item, ',')) list.push_back(Parse<T>(item));
+      return list;
+    }
+
+    std::vector<std::string> GetUnused() const {
+      std::vector<std::string> unused;
+      for(const auto& entry : values_)
+        if(!used_.count(entry.first)) unused.push_back(entry.first);
+      return unused;
+    }
+
+  private:
+    // the whole value or nothing, "1.5x" is not 1.5
+    template <class T>
+    static T Parse(const std::string& text) {
+      std::istringstream stream(text);
+      T value;
+      if(!(stream >> value) || !(stream >> std::ws).eof()) throw "BAD SCENARIO VALUE";
+      return value;
+    }
+
+    std::string model_;
+    int line_;
+    std::map<std::string, std::string> values_;
+    std::set<std::string> used_;
+  }; // class Scenario
+
+  // the scenarios of a file in order, one per line, # starts a comment. a
+  // line "defaults <model> ..." gives the later scenarios of that model the
+  // keys they do not set. throws the line number of a line with a key and
+  // no value.
+  inline std::vector<Scenario> ReadScenarioFile(const std::string& path) {
+    std::ifstream file(path);
+    if(!file.is_open()) throw "CANNOT OPEN SCENARIO FILE";
+
+    std::vector<Scenario> scenarios;
+    std::map<std::string, Scenario> defaults;
+    std::string text;
+
+    for(int line = 1; std::getline(file, text); line++) {
+      std::stringstream tokens(text.substr(0, text.find('#')));
+      std::string model, key, value;
+      if(!(tokens >> model)) continue;
+
+      bool is_defaults = model == "defaults";
+      if(is_defaults && !(tokens >> model)) throw (line);
+
+      Scenario scenario(model, line);
+      while(tokens >> key) {
+        if(!(tokens >> value)) throw (line);
+        scenario.Set(key, value);
+      }
+      if(defaults.count(model)) scenario.SetDefaults(defaults[model]);
+
+      if(is_defaults) defaults[model] = scenario;
+      else scenarios.push_back(scenario);
+    }
+
+    return scenarios;
+  }
+
+} // namespace common
+
+#endif // COMMON_SCENARIO_H_
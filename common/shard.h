@@ -0,0 +1,308 @@
+#ifndef COMMON_SHARD_H_
+#define COMMON_SHARD_H_
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "checkpoint.h"
+#include "statistics.h"
+
+namespace common {
+
+  // named summaries over the replications of a shard, what a worker process
+  // sends back. merging adds up summaries of the same name, and the bytes use
+  // the checkpoint layout so a torn message from a dying worker is rejected.
+  class PartialResult {
+  public:
+    static const uint32_t kMagic = 0x54524150; // "PART"
+    static const uint32_t kVersion = 1;
+
+    void Add(const std::string& name, double x) {
+      summaries_[name].Add(x);
+    }
+
+    void Add(const std::string& name, const Summary& summary) {
+      summaries_[name].Merge(summary);
+    }
+
+    void Merge(const PartialResult& other) {
+      for(const auto& entry : other.summaries_) summaries_[entry.first].Merge(entry.second);
+    }
+
+    const std::map<std::string, Summary>& GetSummaries() const { return summaries_; }
+
+    std::string Serialize() const {
+      CheckpointBuffer buffer;
+      buffer.Put<uint64_t>(summaries_.size());
+      for(const auto& entry : summaries_) {
+        buffer.PutVector(std::vector<char>(entry.first.begin(), entry.first.end()));
+        buffer.Put(entry.second.GetCount());
+        buffer.Put(entry.second.GetMean());
+        buffer.Put(entry.second.GetM2());
+      }
+      return buffer.Finish(kMagic, kVersion);
+    }
+
+    bool Deserialize(const std::string& bytes) {
+      CheckpointReader reader;
+      uint64_t n;
+      if(!reader.Open(bytes, kMagic, kVersion) || !reader.Get(n)) return false;
+
+      summaries_.clear();
+      for(uint64_t i = 0; i < n; i++) {
+        std::vector<char> name;
+        long long count;
+        double mean, m2;
+        if(!reader.GetVector(name) || !reader.Get(count) || !reader.Get(mean) || !reader.Get(m2))
+          return false;
+        summaries_[std::string(name.begin(), name.end())].Set(count, mean, m2);
+      }
+      return reader.IsDone();
+    }
+
+    // mean and 95% half width of every summary, one per line
+    std::string GetReport() const {
+      std::stringstream report;
+      for(const auto& entry : summaries_)
+        report << entry.first << ": " << entry.second.GetMean() << " +- "
+               << entry.second.GetHalfWidth() << " (" << entry.second.GetCount() << " replications)"
+               << std::endl;
+      return report.str();
+    }
+
+  private:
+    std::map<std::string, Summary> summaries_;
+  }; // class PartialResult
+
+  // replications [first, first + count) of one shard
+  struct Shard {
+    int64_t id, first, count;
+  }; // struct Shard
+
+  // runs the replications of a job in worker processes on this machine. the
+  // coordinator forks n_worker workers, each on its own unix socketpair, and
+  // hands out shards as workers come free; a worker runs work(first, count)
+  // and writes back the PartialResult. a worker that exits, crashes or sends
+  // a torn result is replaced and its shard goes back in the queue, up to
+  // max_attempt tries per shard, after which Run kills and reaps every worker
+  // and throws. the shards are merged in id order at the end, so the answer
+  // does not depend on which worker ran what. workers are forked, so call Run
+  // before starting any threads (progress samplers, checkpoint writers).
+  class ShardRunner {
+  public:
+    typedef std::function<PartialResult(int64_t, int64_t)> Work;
+
+    // n_worker 0 uses one worker per hardware thread
+    explicit ShardRunner(int n_worker = 0, int max_attempt = 3)
+      : n_worker_(n_worker), max_attempt_(max_attempt), n_rerun_(0) {
+      if(n_worker_ <= 0) n_worker_ = std::thread::hardware_concurrency();
+      if(n_worker_ <= 0) n_worker_ = 1;
+    }
+
+    PartialResult Run(int64_t n_replication, int n_shard, Work work) {
+      if(n_shard > n_replication) n_shard = n_replication;
+      if(n_shard < 1) return PartialResult();
+
+      std::vector<Shard> queue;
+      for(int s = n_shard - 1; s >= 0; s--)
+        queue.push_back(Shard{s, n_replication * s / n_shard,
+                              n_replication * (s + 1) / n_shard - n_replication * s / n_shard});
+      std::vector<PartialResult> results(n_shard);
+      std::vector<int> attempts(n_shard, 0);
+      int n_done = 0;
+
+      int n_worker = n_worker_ < n_shard ? n_worker_ : n_shard;
+      std::vector<Worker> workers(n_worker);
+      try {
+        for(Worker& w : workers) Fork(w, work);
+
+        while(n_done < n_shard) {
+          // idle workers take the next shard. a worker replaced here is idle
+          // again, so dispatch once more before waiting on the others
+          bool replaced = false;
+          for(Worker& w : workers) {
+            if(w.shard.id >= 0 || queue.empty()) continue;
+            w.shard = queue.back();
+            queue.pop_back();
+            attempts[w.shard.id]++;
+            if(!WriteAll(w.fd, &w.shard, sizeof(Shard))) {
+              Replace(w, queue, attempts, work);
+              replaced = true;
+            }
+          }
+          if(replaced) continue;
+
+          std::vector<pollfd> fds;
+          for(Worker& w : workers) fds.push_back(pollfd{w.fd, POLLIN, 0});
+          if(poll(fds.data(), fds.size(), -1) < 0) {
+            if(errno == EINTR) continue;
+            throw "SHARD POLL FAILED";
+          }
+
+          for(size_t i = 0; i < workers.size(); i++) {
+            Worker& w = workers[i];
+            if(!fds[i].revents) continue;
+
+            std::string bytes;
+            PartialResult result;
+            if(w.shard.id >= 0 && ReadMessage(w.fd, bytes) && result.Deserialize(bytes)) {
+              results[w.shard.id] = result;
+              n_done++;
+              w.shard.id = -1;
+            }
+            else {
+              Replace(w, queue, attempts, work);
+            }
+          }
+        }
+      }
+      catch(...) {
+        // no worker outlives a failed run
+        for(Worker& w : workers) {
+          if(w.pid > 0) kill(w.pid, SIGKILL);
+          Stop(w);
+        }
+        throw;
+      }
+
+      for(Worker& w : workers) Stop(w);
+
+      PartialResult merged;
+      for(PartialResult& r : results) merged.Merge(r);
+      return merged;
+    }
+
+    // shards run again after their worker died
+    int GetNRerun() { return n_rerun_; }
+    int GetNWorker() { return n_worker_; }
+
+  private:
+    struct Worker {
+      pid_t pid = -1;
+      int fd = -1;
+      Shard shard = Shard{-1, 0, 0};
+    }; // struct Worker
+
+    static const uint64_t kMaxMessage = 1ULL << 30;
+
+    static bool WriteAll(int fd, const void* data, size_t size) {
+      const char* p = (const char*)data;
+      while(size) {
+        ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+        if(n < 0 && errno == EINTR) continue;
+        if(n <= 0) return false;
+        p += n;
+        size -= n;
+      }
+      return true;
+    }
+
+    static bool ReadAll(int fd, void* data, size_t size) {
+      char* p = (char*)data;
+      while(size) {
+        ssize_t n = read(fd, p, size);
+        if(n < 0 && errno == EINTR) continue;
+        if(n <= 0) return false;
+        p += n;
+        size -= n;
+      }
+      return true;
+    }
+
+    // a size, then that many bytes
+    static bool ReadMessage(int fd, std::string& bytes) {
+      uint64_t size;
+      if(!ReadAll(fd, &size, sizeof(size)) || size > kMaxMessage) return false;
+      bytes.resize(size);
+      return ReadAll(fd, &bytes[0], size);
+    }
+
+    // the worker side: shards in, results out, until the socket closes. it
+    // leaves with _exit so the coordinator's buffers and destructors are not
+    // run twice
+    static void RunWorker(int fd, Work& work) {
+      Shard shard;
+      int status = 0;
+      while(ReadAll(fd, &shard, sizeof(Shard))) {
+        try {
+          std::string bytes = work(shard.first, shard.count).Serialize();
+          uint64_t size = bytes.size();
+          if(!WriteAll(fd, &size, sizeof(size)) || !WriteAll(fd, bytes.data(), size)) break;
+        }
+        catch(...) {
+          status = 1;
+          break;
+        }
+      }
+      close(fd);
+      _exit(status);
+    }
+
+    void Fork(Worker& w, Work& work) {
+      int fds[2];
+      if(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) throw "SHARD SOCKETPAIR FAILED";
+
+      std::cout.flush();
+      std::cerr.flush();
+      std::fflush(nullptr);
+
+      pid_t pid = fork();
+      if(pid < 0) throw "SHARD FORK FAILED";
+      if(pid == 0) {
+        // the other workers' sockets too, or they would never see end of file
+        close(fds[0]);
+        for(int fd : coordinator_fds_) close(fd);
+        RunWorker(fds[1], work);
+      }
+
+      close(fds[1]);
+      coordinator_fds_.push_back(fds[0]);
+      w.pid = pid;
+      w.fd = fds[0];
+      w.shard.id = -1;
+    }
+
+    void Stop(Worker& w) {
+      if(w.fd >= 0) {
+        close(w.fd);
+        coordinator_fds_.erase(std::find(coordinator_fds_.begin(), coordinator_fds_.end(), w.fd));
+      }
+      if(w.pid > 0) waitpid(w.pid, nullptr, 0);
+      w.fd = -1;
+      w.pid = -1;
+    }
+
+    void Replace(Worker& w, std::vector<Shard>& queue, std::vector<int>& attempts, Work& work) {
+      Shard shard = w.shard;
+      if(w.pid > 0) kill(w.pid, SIGKILL);
+      Stop(w);
+
+      if(shard.id >= 0) {
+        if(attempts[shard.id] >= max_attempt_) throw "SHARD FAILED";
+        queue.push_back(shard);
+        n_rerun_++;
+      }
+      Fork(w, work);
+    }
+
+    int n_worker_, max_attempt_, n_rerun_;
+    std::vector<int> coordinator_fds_;
+  }; // class ShardRunner
+
+} // namespace common
+
+#endif // COMMON_SHARD_H_
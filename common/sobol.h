@@ -0,0 +1,111 @@
+#ifndef COMMON_SOBOL_H_
+#define COMMON_SOBOL_H_
+
+#include <cstdint>
+
+namespace common {
+
+  // Sobol low discrepancy points (Joe and Kuo direction numbers) in gray code
+  // order, with hash based Owen scrambling (Burley 2020). any 2^m consecutive
+  // points from a multiple of 2^m are a full net, and every seed scrambles the
+  // digits independently, so runs with different seeds are independent
+  // randomized replications of the same net.
+  class Sobol {
+  public:
+    static const int kMaxDimension = 8;
+
+    explicit Sobol(uint32_t seed = 0) {
+      SetDirections();
+      Seed(seed);
+    }
+
+    void Seed(uint32_t seed) {
+      for(int d = 0; d < kMaxDimension; d++)
+        seeds_[d] = Hash(seed ^ Hash(d + 1));
+    }
+
+    // coordinate dimension of point index as a 32 bit uniform
+    uint32_t Get(uint32_t index, int dimension) const {
+      uint32_t gray = index ^ (index >> 1), x = 0;
+      for(int k = 0; gray; k++, gray >>= 1)
+        if(gray & 1) x ^= directions_[dimension][k];
+
+      return Scramble(x, seeds_[dimension]);
+    }
+
+    // coordinate dimension of points start..start + n - 1, stepping the gray
+    // code so each point costs one xor
+    void Fill(uint32_t* out, uint32_t start, int n, int dimension) const {
+      if(n <= 0) return;
+
+      uint32_t gray = start ^ (start >> 1), x = 0;
+      for(int k = 0; gray; k++, gray >>= 1)
+        if(gray & 1) x ^= directions_[dimension][k];
+
+      for(int i = 0; i < n; i++) {
+        out[i] = Scramble(x, seeds_[dimension]);
+        x ^= directions_[dimension][__builtin_ctz(start + i + 1)];
+      }
+    }
+
+  private:
+    void SetDirections() {
+      // degree s, coefficients a and initial m of dimensions 2..kMaxDimension
+      static const uint32_t kS[] = {1, 2, 3, 3, 4, 4, 5};
+      static const uint32_t kA[] = {0, 1, 1, 2, 1, 4, 2};
+      static const uint32_t kM[][5] = {{1}, {1, 3}, {1, 3, 1}, {1, 1, 1}, {1, 1, 3, 3},
+                                       {1, 3, 5, 13}, {1, 1, 5, 5, 17}};
+
+      for(int k = 0; k < 32; k++)
+        directions_[0][k] = 1u << (31 - k);
+
+      for(int d = 1; d < kMaxDimension; d++) {
+        uint32_t s = kS[d - 1], a = kA[d - 1];
+        uint32_t* v = directions_[d];
+
+        for(uint32_t k = 0; k < s; k++)
+          v[k] = kM[d - 1][k] << (31 - k);
+
+        for(uint32_t k = s; k < 32; k++) {
+          v[k] = v[k - s] ^ (v[k - s] >> s);
+          for(uint32_t l = 1; l < s; l++)
+            if((a >> (s - 1 - l)) & 1) v[k] ^= v[k - l];
+        }
+      }
+    }
+
+    static uint32_t Hash(uint32_t x) {
+      x ^= x >> 16;
+      x *= 0x7feb352du;
+      x ^= x >> 15;
+      x *= 0x846ca68bu;
+      x ^= x >> 16;
+      return x;
+    }
+
+    static uint32_t ReverseBits(uint32_t x) {
+      x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+      x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+      x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+      x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+      return (x >> 16) | (x << 16);
+    }
+
+    // nested uniform scramble: a hash of the reversed bits only lets every
+    // bit depend on the bits above it, which is what Owen scrambling flips
+    static uint32_t Scramble(uint32_t x, uint32_t seed) {
+      x = ReverseBits(x);
+      x += seed;
+      x ^= x * 0x6c50b47cu;
+      x ^= x * 0xb82f1e52u;
+      x ^= x * 0xc7afe638u;
+      x ^= x * 0x8d22f6e6u;
+      return ReverseBits(x);
+    }
+
+    uint32_t directions_[kMaxDimension][32], seeds_[kMaxDimension];
+  }; // class Sobol
+
+} // namespace common
+
+#endif // COMMON_SOBOL_H_
@@ -0,0 +1,142 @@
+#ifndef COMMON_STATISTICS_H_
+#define COMMON_STATISTICS_H_
+
+#include <algorithm>
+#include <cmath>
+
+namespace common {
+
+  // inverse of the standard normal cdf (Acklam), relative error below 1.2e-9
+  inline double GetNormalQuantile(double p) {
+    const double a[] = {-3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02,
+                        1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00};
+    const double b[] = {-5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02,
+                        6.680131188771972e+01, -1.328068155288572e+01};
+    const double c[] = {-7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+                        -2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00};
+    const double d[] = {7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00,
+                        3.754408661907416e+00};
+    const double kLow = 0.02425;
+
+    if(p < kLow) {
+      double q = std::sqrt(-2 * std::log(p));
+      return (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5])
+        / ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+    }
+    if(p > 1 - kLow) return -GetNormalQuantile(1 - p);
+
+    double q = p - 0.5, r = q * q;
+    return (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q
+      / (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1);
+  }
+
+  // student t quantile from the normal one (Cornish-Fisher expansion), good to
+  // a few parts in a thousand from 3 degrees of freedom on
+  inline double GetTQuantile(double p, long long dof) {
+    double z = GetNormalQuantile(p);
+    if(dof <= 0) return z;
+
+    double n = dof, z2 = z * z;
+    return z
+      + (z2 + 1) * z / (4 * n)
+      + ((5 * z2 + 16) * z2 + 3) * z / (96 * n * n)
+      + (((3 * z2 + 19) * z2 + 17) * z2 - 15) * z / (384 * n * n * n);
+  }
+
+  // running count, mean and variance (Welford). two summaries of disjoint
+  // samples merge into the summary of their union (Chan et al.)
+  class Summary {
+  public:
+    Summary() : count_(0), mean_(0), m2_(0) {}
+
+    void Add(double x) {
+      count_++;
+      double delta = x - mean_;
+      mean_ += delta / count_;
+      m2_ += delta * (x - mean_);
+    }
+
+    void Merge(const Summary& other) {
+      if(other.count_ == 0) return;
+      if(count_ == 0) {
+        *this = other;
+        return;
+      }
+
+      long long count = count_ + other.count_;
+      double delta = other.mean_ - mean_;
+      mean_ += delta * other.count_ / count;
+      m2_ += other.m2_ + delta * delta * ((double)count_ * other.count_ / count);
+      count_ = count;
+    }
+
+    long long GetCount() const { return count_; }
+    double GetMean() const { return mean_; }
+    double GetVariance() const { return count_ > 1 ? m2_ / (count_ - 1) : 0; }
+    double GetStdError() const { return count_ > 1 ? std::sqrt(GetVariance() / count_) : 0; }
+
+    // half width of the two sided confidence interval of the mean
+    double GetHalfWidth(double confidence = 0.95) const {
+      if(count_ < 2) return INFINITY;
+      return GetTQuantile(0.5 + confidence / 2, count_ - 1) * GetStdError();
+    }
+
+    // raw moments, e.g. for serializing a summary
+    double GetM2() const { return m2_; }
+    void Set(long long count, double mean, double m2) {
+      count_ = count;
+      mean_ = mean;
+      m2_ = m2;
+    }
+
+  private:
+    long long count_;
+    double mean_, m2_;
+  }; // class Summary
+
+  // sum(x) / sum(y) over independent (x, y) pairs, e.g. the total delay and
+  // the customers of each replication, with a delta method interval. plain
+  // sums, so pairs and merges may come in any order
+  class RatioSummary {
+  public:
+    RatioSummary() : count_(0), x_(0), y_(0), xx_(0), yy_(0), xy_(0) {}
+
+    void Add(double x, double y) {
+      count_++;
+      x_ += x;
+      y_ += y;
+      xx_ += x * x;
+      yy_ += y * y;
+      xy_ += x * y;
+    }
+
+    void Merge(const RatioSummary& other) {
+      count_ += other.count_;
+      x_ += other.x_;
+      y_ += other.y_;
+      xx_ += other.xx_;
+      yy_ += other.yy_;
+      xy_ += other.xy_;
+    }
+
+    long long GetCount() const { return count_; }
+    double GetRatio() const { return y_ != 0 ? x_ / y_ : 0; }
+
+    double GetHalfWidth(double confidence = 0.95) const {
+      if(count_ < 2 || y_ == 0) return INFINITY;
+
+      double n = count_, r = GetRatio(), mean_y = y_ / n;
+      double var_x = (xx_ - x_ * x_ / n) / (n - 1), var_y = (yy_ - y_ * y_ / n) / (n - 1);
+      double cov = (xy_ - x_ * y_ / n) / (n - 1);
+      double var = (var_x - 2 * r * cov + r * r * var_y) / (n * mean_y * mean_y);
+      return GetTQuantile(0.5 + confidence / 2, count_ - 1) * std::sqrt(std::max(var, 0.0));
+    }
+
+  private:
+    long long count_;
+    double x_, y_, xx_, yy_, xy_;
+  }; // class RatioSummary
+
+} // namespace common
+
+#endif // COMMON_STATISTICS_H_
@@ -0,0 +1,80 @@
+#ifndef COMMON_THREAD_POOL_H_
+#define COMMON_THREAD_POOL_H_
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace common {
+
+  // fixed set of worker threads taking tasks from one queue
+  class ThreadPool {
+  public:
+    // n_thread 0 uses one thread per hardware thread
+    explicit ThreadPool(int n_thread = 0) : stop_(false) {
+      if(n_thread <= 0) n_thread = std::thread::hardware_concurrency();
+      if(n_thread <= 0) n_thread = 1;
+
+      for(int i = 0; i < n_thread; i++)
+        threads_.emplace_back(&ThreadPool::Run, this);
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // finishes the queued tasks before joining
+    ~ThreadPool() {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+      }
+      cv_.notify_all();
+      for(std::thread& t : threads_) t.join();
+    }
+
+    template <class F>
+    auto Submit(F f) -> std::future<decltype(f())> {
+      auto task = std::make_shared<std::packaged_task<decltype(f())()>>(std::move(f));
+      auto future = task->get_future();
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push([task] { (*task)(); });
+      }
+      cv_.notify_one();
+      return future;
+    }
+
+    int GetNThread() {
+      return threads_.size();
+    }
+
+  private:
+    void Run() {
+      while(true) {
+        std::function<void()> task;
+        {
+          std::unique_lock<std::mutex> lock(mutex_);
+          cv_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+          if(tasks_.empty()) return;
+          task = std::move(tasks_.front());
+          tasks_.pop();
+        }
+        task();
+      }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::queue<std::function<void()>> tasks_;
+    std::vector<std::thread> threads_;
+    bool stop_;
+  }; // class ThreadPool
+
+} // namespace common
+
+#endif // COMMON_THREAD_POOL_H_
@@ -0,0 +1,445 @@
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+
+#include "network.h"
+
+using namespace queue_network;
+
+// uniform on (0, 1) with the full 32 bits, so exponential services are never
+// zero and a partition always has some lookahead
+static double GetUniform(common::Random& random) {
+  return (random.Next() + 0.5) / 4294967296.0;
+}
+
+TimeModel::TimeModel(Type type, double a, double b) : type_(type), a_(a), b_(b) {}
+
+TimeModel TimeModel::Exponential(double mean) {
+  return TimeModel(kExponential, mean);
+}
+
+TimeModel TimeModel::Deterministic(double time) {
+  return TimeModel(kDeterministic, time);
+}
+
+TimeModel TimeModel::Uniform(double low, double high) {
+  return TimeModel(kUniform, low, high);
+}
+
+// sum of k exponential phases with the given total mean
+TimeModel TimeModel::Erlang(int k, double mean) {
+  return TimeModel(kErlang, mean, k);
+}
+
+double TimeModel::GetTime(common::Random& random) {
+  switch(type_) {
+  case kExponential:
+    return -a_ * std::log(GetUniform(random));
+  case kDeterministic:
+    return a_;
+  case kUniform:
+    return a_ + (b_ - a_) * GetUniform(random);
+  case kErlang: {
+    double product = 1;
+    for(int i = 0; i < b_; i++) product *= GetUniform(random);
+    return -a_ / b_ * std::log(product);
+  }
+  default:
+    throw (type_);
+  }
+}
+
+double TimeModel::GetMean() {
+  return type_ == kUniform ? (a_ + b_) / 2 : a_;
+}
+
+int Network::AddNode(TimeModel service, int n_server) {
+  if(n_server < 1) throw (n_server);
+  nodes_.push_back({n_server, service, {}, {}});
+  return nodes_.size() - 1;
+}
+
+void Network::AddRoute(int from, int to, double p) {
+  Node& node = GetNode(from);
+  GetNode(to);
+
+  double cum = node.cum_prob.empty() ? 0 : node.cum_prob.back();
+  if(p < 0 || cum + p > 1 + 1e-9) throw "ROUTING PROBABILITIES ABOVE ONE";
+
+  node.next.push_back(to);
+  node.cum_prob.push_back(cum + p);
+}
+
+void Network::AddSource(int node, TimeModel interarrival) {
+  GetNode(node);
+  sources_.push_back({node, interarrival});
+}
+
+int Network::GetNNode() {
+  return nodes_.size();
+}
+
+int Network::GetNSource() {
+  return sources_.size();
+}
+
+Node& Network::GetNode(int i) {
+  if(i < 0 || i >= (int)nodes_.size()) throw (i);
+  return nodes_[i];
+}
+
+Source& Network::GetSource(int i) {
+  if(i < 0 || i >= (int)sources_.size()) throw (i);
+  return sources_[i];
+}
+
+// one source, single servers and every node fed by at most one upstream: then
+// customers reach every node in the order they entered, and one pass per
+// customer with the Lindley recursion is the whole simulation
+bool Network::IsLindleyTree() {
+  if(sources_.size() != 1) return false;
+
+  std::vector<int> n_upstream(nodes_.size(), 0);
+  n_upstream[sources_[0].node]++;
+  for(Node& node : nodes_) {
+    if(node.n_server != 1) return false;
+    for(int next : node.next) n_upstream[next]++;
+  }
+
+  for(int n : n_upstream)
+    if(n > 1) return false;
+
+  return true;
+}
+
+Simulator::Simulator(Network& network, uint64_t seed) : network_(network), seed_(seed) {
+  engine_ = kAuto;
+  n_warm_up_ = n_total_ = 0;
+  self_ = 0;
+}
+
+EngineType Simulator::GetEngine() {
+  return engine_;
+}
+
+NetworkMetrics& Simulator::GetMetrics() {
+  return metrics_;
+}
+
+void Simulator::SetPartition(std::vector<int> owner, int self,
+                             std::vector<common::SpscChannel<NetworkEvent>*> outbox) {
+  owner_ = owner;
+  self_ = self;
+  outbox_ = outbox;
+}
+
+bool Simulator::IsLocal(int node) {
+  return owner_.empty() || owner_[node] == self_;
+}
+
+void Simulator::Reset(long long n_warm_up, long long n_customer) {
+  int n_node = network_.GetNNode(), n_source = network_.GetNSource();
+  n_warm_up_ = n_warm_up;
+  n_total_ = n_warm_up + n_customer;
+
+  metrics_ = NetworkMetrics();
+  metrics_.nodes.assign(n_node, NodeMetrics());
+  metrics_.first_entry = std::numeric_limits<double>::infinity();
+
+  source_random_.resize(n_source);
+  service_random_.resize(n_node);
+  route_random_.resize(n_node);
+  for(int i = 0; i < n_source; i++)
+    source_random_[i].Seed(seed_, i);
+  for(int i = 0; i < n_node; i++) {
+    service_random_[i].Seed(seed_, n_source + 2 * i);
+    route_random_[i].Seed(seed_, n_source + 2 * i + 1);
+  }
+
+  n_entered_.assign(n_source, 0);
+  events_.clear();
+  queues_.assign(n_node, common::ChunkQueue<Waiting>(&arena_));
+  arena_.Reset();
+  n_busy_.assign(n_node, 0);
+  busy_until_.assign(n_node, 0);
+}
+
+// engine kAuto takes the Lindley pass whenever the network allows it
+NetworkMetrics Simulator::RunSimulation(long long n_warm_up, long long n_customer,
+                                        EngineType engine) {
+  if(network_.GetNSource() == 0) throw "NETWORK WITHOUT SOURCE";
+
+  bool tree = network_.IsLindleyTree();
+  if(engine == kLindley && !tree) throw "NETWORK NEEDS THE EVENT ENGINE";
+  engine_ = engine == kAuto ? (tree ? kLindley : kEvent) : engine;
+
+  Reset(n_warm_up, n_customer);
+  if(engine_ == kLindley) {
+    RunLindley();
+  }
+  else {
+    StartEvents();
+    RunEvents(std::numeric_limits<double>::infinity());
+  }
+
+  SetMetrics(network_, metrics_);
+  return metrics_;
+}
+
+int Simulator::Route(int node) {
+  Node& n = network_.GetNode(node);
+  if(n.next.empty()) return -1;
+
+  double u = GetUniform(route_random_[node]);
+  for(size_t i = 0; i < n.next.size(); i++)
+    if(u <= n.cum_prob[i]) return n.next[i];
+
+  return -1;
+}
+
+// draws the service and the next node of a customer starting at start. an
+// arrival at another partition is sent right away, timestamped with the
+// departure, which is the lookahead the partitions synchronize on.
+NetworkEvent Simulator::Serve(int node, long long customer, double entry, double arrival,
+                              double start) {
+  double service = network_.GetNode(node).service.GetTime(service_random_[node]);
+  NetworkEvent departure = {start + service, kDepartureEvent, node, -1, Route(node), customer, entry};
+
+  if(customer >= n_warm_up_) {
+    NodeMetrics& m = metrics_.nodes[node];
+    m.wait += start - arrival;
+    m.service += service;
+    m.n_customer++;
+    if(start > arrival) m.n_waited++;
+  }
+
+  if(departure.next >= 0 && !IsLocal(departure.next)) {
+    NetworkEvent arrive = departure;
+    arrive.type = kArrivalEvent;
+    arrive.node = departure.next;
+    outbox_[owner_[departure.next]]->Push(arrive);
+  }
+
+  return departure;
+}
+
+void Simulator::Exit(int node, long long customer, double entry, double time) {
+  if(customer < n_warm_up_) return;
+
+  NodeMetrics& m = metrics_.nodes[node];
+  m.spent += time - entry;
+  m.n_exit++;
+  m.last_exit = std::max(m.last_exit, time);
+}
+
+// every customer walks its whole route at once: a node starts serving it at
+// max(arrival, previous departure), O(1) per hop and no event list
+void Simulator::RunLindley() {
+  Source& source = network_.GetSource(0);
+  std::vector<double> last_departure(network_.GetNNode(), 0);
+  double entry = 0;
+
+  for(long long customer = 0; customer < n_total_; customer++) {
+    entry += source.interarrival.GetTime(source_random_[0]);
+    if(customer == n_warm_up_) metrics_.first_entry = entry;
+
+    double time = entry;
+    int node = source.node;
+    while(true) {
+      double start = std::max(time, last_departure[node]);
+      NetworkEvent departure = Serve(node, customer, entry, time, start);
+      time = last_departure[node] = departure.time;
+
+      if(departure.next < 0) break;
+      node = departure.next;
+    }
+
+    Exit(node, customer, entry, time);
+  }
+}
+
+void Simulator::Push(NetworkEvent event) {
+  events_.push_back(event);
+  std::push_heap(events_.begin(), events_.end(), std::greater<NetworkEvent>());
+}
+
+void Simulator::Receive(NetworkEvent& event) {
+  Push(event);
+}
+
+void Simulator::Arrive(int node, long long customer, double entry, double time) {
+  if(n_busy_[node] < network_.GetNode(node).n_server) {
+    n_busy_[node]++;
+    NetworkEvent departure = Serve(node, customer, entry, time, time);
+    busy_until_[node] = std::max(busy_until_[node], departure.time);
+    Push(departure);
+  }
+  else {
+    queues_[node].push_back({customer, entry, time});
+  }
+}
+
+void Simulator::Depart(NetworkEvent& event) {
+  int node = event.node;
+  n_busy_[node]--;
+
+  if(!queues_[node].empty()) {
+    Waiting w = queues_[node].front();
+    queues_[node].pop_front();
+    n_busy_[node]++;
+    NetworkEvent departure = Serve(node, w.customer, w.entry, w.arrival, event.time);
+    busy_until_[node] = std::max(busy_until_[node], departure.time);
+    Push(departure);
+  }
+
+  if(event.next < 0) Exit(node, event.customer, event.entry, event.time);
+  else if(IsLocal(event.next)) Arrive(event.next, event.customer, event.entry, event.time);
+}
+
+// first arrival of every local source
+void Simulator::StartEvents() {
+  for(int s = 0; s < network_.GetNSource(); s++) {
+    Source& source = network_.GetSource(s);
+    if(IsLocal(source.node))
+      Push({source.interarrival.GetTime(source_random_[s]), kSourceEvent, source.node, s, -1, 0, 0});
+  }
+}
+
+// general networks: multi server nodes, merges and feedback. processes the
+// events before end
+void Simulator::RunEvents(double end) {
+  while(!events_.empty() && events_.front().time < end) {
+    std::pop_heap(events_.begin(), events_.end(), std::greater<NetworkEvent>());
+    NetworkEvent event = events_.back();
+    events_.pop_back();
+
+    switch(event.type) {
+    case kDepartureEvent:
+      Depart(event);
+      break;
+    case kArrivalEvent:
+      Arrive(event.node, event.customer, event.entry, event.time);
+      break;
+    case kSourceEvent: {
+      long long& n_entered = n_entered_[event.source];
+      if(n_entered == n_total_) break;
+
+      long long customer = n_entered++;
+      if(customer == n_warm_up_)
+        metrics_.first_entry = std::min(metrics_.first_entry, event.time);
+
+      Arrive(event.node, customer, event.time, event.time);
+      event.time += network_.GetSource(event.source).interarrival.GetTime(source_random_[event.source]);
+      Push(event);
+      break;
+    }
+    default:
+      throw (event.type);
+    }
+  }
+}
+
+double Simulator::GetNextEventTime() {
+  return events_.empty() ? std::numeric_limits<double>::infinity() : events_.front().time;
+}
+
+// earliest timestamp this partition can still send when no event before time
+// is left anywhere: a service starting at a node with remote successors
+// begins at time or when its server frees and lasts at least the smallest of
+// the node's next n_server services, peeked from copies of its stream
+double Simulator::GetLookahead(double time) {
+  double lookahead = std::numeric_limits<double>::infinity();
+
+  for(int i = 0; i < network_.GetNNode(); i++) {
+    if(!IsLocal(i)) continue;
+
+    Node& node = network_.GetNode(i);
+    bool remote = false;
+    for(int next : node.next)
+      if(!IsLocal(next)) remote = true;
+    if(!remote) continue;
+
+    common::Random peek = service_random_[i];
+    double service = std::numeric_limits<double>::infinity();
+    for(int k = 0; k < node.n_server; k++)
+      service = std::min(service, node.service.GetTime(peek));
+
+    double start = node.n_server == 1 ? std::max(time, busy_until_[i]) : time;
+    lookahead = std::min(lookahead, start + service);
+  }
+
+  return lookahead;
+}
+
+// system totals over the nodes in index order, then the derived metrics. p is
+// the busy fraction of the servers from the first counted arrival to the
+// last counted departure
+void queue_network::SetMetrics(Network& network, NetworkMetrics& metrics) {
+  metrics.spent = metrics.clock = 0;
+  metrics.n_customer = 0;
+  for(NodeMetrics& m : metrics.nodes) {
+    metrics.spent += m.spent;
+    metrics.n_customer += m.n_exit;
+    metrics.clock = std::max(metrics.clock, m.last_exit);
+  }
+
+  double elapsed = metrics.clock - metrics.first_entry;
+
+  for(int i = 0; i < network.GetNNode(); i++) {
+    NodeMetrics& m = metrics.nodes[i];
+    double capacity = network.GetNode(i).n_server * elapsed;
+    m.idle = capacity - m.service;
+    m.p = capacity > 0 ? m.service / capacity : 0;
+
+    if(m.n_customer > 0) {
+      m.wq = m.wait / m.n_customer;
+      m.lq = m.n_waited / m.n_customer;
+      m.e_s = m.service / m.n_customer;
+    }
+    m.l = m.lq + m.p;
+    m.w = m.wq + m.e_s;
+  }
+
+  if(metrics.n_customer > 0) metrics.r = metrics.spent / metrics.n_customer;
+  if(elapsed > 0) metrics.n = metrics.n_customer / elapsed;
+}
+
+NetworkMetrics queue_network::RunNetworkSimulation(Network& network, long long n_warm_up,
+                                                   long long n_customer, uint64_t seed,
+                                                   EngineType engine) {
+  Simulator simulator(network, seed);
+  return simulator.RunSimulation(n_warm_up, n_customer, engine);
+}
+
+static void PrintValue(std::string label, double value, int precision) {
+  std::cout << "   " << std::left << std::setw(36) << label << std::right << std::setw(30)
+            << std::fixed << std::setprecision(precision) << value << std::endl;
+}
+
+// same layout as PRINT_METRICS of the Fortran tri_q
+void queue_network::PrintMetrics(NetworkMetrics& metrics) {
+  for(size_t i = 0; i < metrics.nodes.size(); i++) {
+    NodeMetrics& m = metrics.nodes[i];
+    std::cout << "server " << i + 1 << " metrics" << std::endl;
+    PrintValue("total idle time:", m.idle, 2);
+    PrintValue("total service time:", m.service, 2);
+    PrintValue("total wait time:", m.wait, 2);
+    PrintValue("total waited customers:", m.n_waited, 0);
+    PrintValue("total server customers:", m.n_customer, 0);
+    PrintValue("average customer in server (L):", m.l, 2);
+    PrintValue("average customer in queue (LQ):", m.lq, 2);
+    PrintValue("average time spent in server (W):", m.w, 2);
+    PrintValue("average waiting time in queue (WQ):", m.wq, 2);
+    PrintValue("average service time (E[S]):", m.e_s, 2);
+    PrintValue("productivity (P):", m.p, 2);
+    std::cout << std::endl;
+  }
+
+  std::cout << "system metrics" << std::endl;
+  PrintValue("average service time of system (R):", metrics.r, 2);
+  PrintValue("average customers in system (N):", metrics.n, 2);
+  PrintValue("clock:", metrics.clock, 2);
+}
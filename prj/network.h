@@ -0,0 +1,174 @@
+#ifndef QUEUE_NETWORK_H_
+#define QUEUE_NETWORK_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../common/channel.h"
+#include "../common/pool.h"
+#include "../common/random.h"
+
+namespace queue_network {
+
+  // random durations of services and interarrival times
+  class TimeModel {
+  public:
+    enum Type {
+      kExponential = 0,
+      kDeterministic,
+      kUniform,
+      kErlang,
+    };
+
+    TimeModel(Type = kExponential, double = 1, double = 0);
+
+    static TimeModel Exponential(double);
+    static TimeModel Deterministic(double);
+    static TimeModel Uniform(double, double);
+    static TimeModel Erlang(int, double);
+
+    double GetTime(common::Random&);
+    double GetMean();
+
+  private:
+    Type type_;
+    double a_, b_;
+  }; // class TimeModel
+
+  // a FIFO station with n_server servers. a customer leaving it goes to
+  // next[i] for the i-th interval of cum_prob and leaves the network when
+  // its draw is above the last one
+  struct Node {
+    int n_server;
+    TimeModel service;
+    std::vector<int> next;
+    std::vector<double> cum_prob;
+  }; // struct Node
+
+  struct Source {
+    int node;
+    TimeModel interarrival;
+  }; // struct Source
+
+  class Network {
+  public:
+    int AddNode(TimeModel, int = 1);
+    void AddRoute(int, int, double);
+    void AddSource(int, TimeModel);
+    int GetNNode(), GetNSource();
+    Node& GetNode(int);
+    Source& GetSource(int);
+    bool IsLindleyTree();
+
+  private:
+    std::vector<Node> nodes_;
+    std::vector<Source> sources_;
+  }; // class Network
+
+  // same metrics as PRINT_METRICS of the Fortran tri_q: lq is the fraction of
+  // customers that waited and l = lq + p. spent, n_exit and last_exit are of
+  // the customers leaving the network here.
+  struct NodeMetrics {
+    double idle, service, wait, n_waited, n_customer;
+    double l, lq, w, wq, e_s, p;
+    double spent, n_exit, last_exit;
+  }; // struct NodeMetrics
+
+  // r is the mean time in the system and, as in tri_q, n the customers per
+  // unit time. the system totals are summed over the nodes in order, so they
+  // do not depend on which thread simulated which node.
+  struct NetworkMetrics {
+    std::vector<NodeMetrics> nodes;
+    double spent, r, n, clock, first_entry;
+    long long n_customer;
+  }; // struct NetworkMetrics
+
+  enum EngineType {
+    kAuto = 0,
+    kLindley,
+    kEvent,
+  };
+
+  enum EventType {
+    kSourceEvent = 0,
+    kArrivalEvent,
+    kDepartureEvent,
+  };
+
+  // the next arrival of source, an arrival at node or a departure from node
+  // towards next, which is -1 when the customer leaves the network
+  struct NetworkEvent {
+    double time;
+    EventType type;
+    int node, source, next;
+    long long customer;
+    double entry;
+
+    bool operator>(const NetworkEvent& other) const {
+      return time > other.time;
+    }
+  }; // struct NetworkEvent
+
+  struct Waiting {
+    long long customer;
+    double entry, arrival;
+  }; // struct Waiting
+
+  // simulates n_customer customers per source after n_warm_up ones. every
+  // source and every node's services and routing draw from their own random
+  // stream and a customer's next node is drawn when its service starts, so
+  // any engine and any partition of the nodes give the same customers the
+  // same draws.
+  class Simulator {
+  public:
+    Simulator(Network&, uint64_t);
+
+    NetworkMetrics RunSimulation(long long, long long, EngineType = kAuto);
+    EngineType GetEngine();
+
+    // a partition owns the nodes with owner[node] == self and sends arrivals
+    // at other nodes to outbox[owner[node]] as soon as their service starts
+    void SetPartition(std::vector<int>, int, std::vector<common::SpscChannel<NetworkEvent>*>);
+    void Reset(long long, long long);
+    void StartEvents();
+    void RunEvents(double);
+    void Receive(NetworkEvent&);
+    double GetNextEventTime();
+    double GetLookahead(double);
+    NetworkMetrics& GetMetrics();
+
+  private:
+    void RunLindley();
+    void Push(NetworkEvent);
+    void Arrive(int, long long, double, double);
+    void Depart(NetworkEvent&);
+    NetworkEvent Serve(int, long long, double, double, double);
+    void Exit(int, long long, double, double);
+    int Route(int);
+    bool IsLocal(int);
+
+    Network network_;
+    uint64_t seed_;
+    EngineType engine_;
+    long long n_warm_up_, n_total_;
+    std::vector<common::Random> source_random_, service_random_, route_random_;
+    std::vector<long long> n_entered_;
+    std::vector<NetworkEvent> events_;
+    common::Arena arena_; // waiting line chunks, reset with the simulator
+    std::vector<common::ChunkQueue<Waiting>> queues_;
+    std::vector<int> n_busy_;
+    std::vector<double> busy_until_;
+    std::vector<int> owner_;
+    int self_;
+    std::vector<common::SpscChannel<NetworkEvent>*> outbox_;
+    NetworkMetrics metrics_;
+  }; // class Simulator
+
+  void SetMetrics(Network&, NetworkMetrics&);
+  NetworkMetrics RunNetworkSimulation(Network&, long long, long long, uint64_t, EngineType);
+  void PrintMetrics(NetworkMetrics&);
+
+} // namespace queue_network
+
+#endif // QUEUE_NETWORK_H_
@@ -0,0 +1,112 @@
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+#include "parallel.h"
+
+using namespace queue_network;
+
+ParallelSimulator::ParallelSimulator(Network& network, uint64_t seed, int n_thread)
+  : network_(network), seed_(seed), n_thread_(n_thread) {
+  if(n_thread_ < 1) throw (n_thread_);
+  n_warm_up_ = n_customer_ = n_window_ = 0;
+  stalled_ = false;
+
+  // contiguous blocks of nodes by default
+  int n_node = network_.GetNNode();
+  owner_.resize(n_node);
+  for(int i = 0; i < n_node; i++)
+    owner_[i] = (long long)i * n_thread_ / n_node;
+}
+
+void ParallelSimulator::SetPartition(std::vector<int> owner) {
+  if((int)owner.size() != network_.GetNNode()) throw "PARTITION SIZE MISMATCH";
+  for(int p : owner)
+    if(p < 0 || p >= n_thread_) throw (p);
+
+  owner_ = owner;
+}
+
+long long ParallelSimulator::GetNWindow() {
+  return n_window_;
+}
+
+NetworkMetrics ParallelSimulator::RunSimulation(long long n_warm_up, long long n_customer) {
+  if(network_.GetNSource() == 0) throw "NETWORK WITHOUT SOURCE";
+  n_warm_up_ = n_warm_up;
+  n_customer_ = n_customer;
+  n_window_ = 0;
+  stalled_ = false;
+
+  channels_.clear();
+  for(int i = 0; i < n_thread_ * n_thread_; i++)
+    channels_.emplace_back(new common::SpscChannel<NetworkEvent>);
+
+  simulators_.clear();
+  for(int p = 0; p < n_thread_; p++) {
+    std::vector<common::SpscChannel<NetworkEvent>*> outbox(n_thread_);
+    for(int q = 0; q < n_thread_; q++)
+      outbox[q] = q == p ? nullptr : channels_[p * n_thread_ + q].get();
+
+    simulators_.emplace_back(new Simulator(network_, seed_));
+    simulators_[p]->SetPartition(owner_, p, outbox);
+    simulators_[p]->Reset(n_warm_up_, n_customer_);
+  }
+
+  next_time_.assign(n_thread_, 0);
+  lookahead_.assign(n_thread_, 0);
+  barrier_.reset(new common::SpinBarrier(n_thread_));
+
+  std::vector<std::thread> threads;
+  for(int p = 1; p < n_thread_; p++)
+    threads.emplace_back(&ParallelSimulator::RunPartition, this, p);
+  RunPartition(0);
+  for(std::thread& t : threads) t.join();
+
+  if(stalled_) throw "NETWORK WITHOUT LOOKAHEAD";
+
+  NetworkMetrics metrics;
+  metrics.nodes.resize(network_.GetNNode());
+  metrics.first_entry = std::numeric_limits<double>::infinity();
+  for(int i = 0; i < network_.GetNNode(); i++)
+    metrics.nodes[i] = simulators_[owner_[i]]->GetMetrics().nodes[i];
+  for(auto& simulator : simulators_)
+    metrics.first_entry = std::min(metrics.first_entry, simulator->GetMetrics().first_entry);
+
+  SetMetrics(network_, metrics);
+  return metrics;
+}
+
+// every thread sees the same minima after each barrier, so they all leave
+// the loop in the same window
+void ParallelSimulator::RunPartition(int p) {
+  const double kInf = std::numeric_limits<double>::infinity();
+  Simulator& simulator = *simulators_[p];
+  simulator.StartEvents();
+
+  while(true) {
+    NetworkEvent event;
+    for(int q = 0; q < n_thread_; q++)
+      if(q != p)
+        while(channels_[q * n_thread_ + p]->Pop(event)) simulator.Receive(event);
+
+    next_time_[p] = simulator.GetNextEventTime();
+    barrier_->Wait();
+
+    double time = *std::min_element(next_time_.begin(), next_time_.end());
+    if(time == kInf) break;
+
+    lookahead_[p] = simulator.GetLookahead(time);
+    barrier_->Wait();
+
+    double end = *std::min_element(lookahead_.begin(), lookahead_.end());
+    if(end <= time) {
+      if(p == 0) stalled_ = true;
+      break;
+    }
+
+    if(p == 0) n_window_++;
+    simulator.RunEvents(end);
+    barrier_->Wait();
+  }
+}
@@ -0,0 +1,45 @@
+#ifndef QUEUE_NETWORK_PARALLEL_H_
+#define QUEUE_NETWORK_PARALLEL_H_
+
+#include <memory>
+#include <vector>
+
+#include "network.h"
+#include "../common/barrier.h"
+#include "../common/channel.h"
+
+namespace queue_network {
+
+  // conservative parallel event engine. the nodes are split over n_thread
+  // partitions, each one a Simulator on its own thread, and time advances in
+  // windows: with T the earliest pending event anywhere and W the earliest
+  // timestamp any partition can still send (GetLookahead), every partition
+  // processes its events before W without waiting for the others, since
+  // nothing it has not received yet can be earlier. arrivals at remote nodes
+  // go through one lock free SPSC channel per pair of partitions.
+  class ParallelSimulator {
+  public:
+    ParallelSimulator(Network&, uint64_t, int);
+
+    void SetPartition(std::vector<int>);
+    NetworkMetrics RunSimulation(long long, long long);
+    long long GetNWindow();
+
+  private:
+    void RunPartition(int);
+
+    Network network_;
+    uint64_t seed_;
+    int n_thread_;
+    long long n_warm_up_, n_customer_, n_window_;
+    std::vector<int> owner_;
+    std::vector<std::unique_ptr<Simulator>> simulators_;
+    std::vector<std::unique_ptr<common::SpscChannel<NetworkEvent>>> channels_;
+    std::vector<double> next_time_, lookahead_;
+    std::unique_ptr<common::SpinBarrier> barrier_;
+    bool stalled_;
+  }; // class ParallelSimulator
+
+} // namespace queue_network
+
+#endif // QUEUE_NETWORK_PARALLEL_H_
@@ -0,0 +1,108 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "network.h"
+#include "parallel.h"
+
+using namespace queue_network;
+
+// a ring of n_node stations, each with its own source. a customer leaving
+// node i goes on to i + 1 or across the ring to i + n_node / 2 + 1, or leaves
+// with probability 0.1, so it visits ten servers on average and half of its
+// hops cross partitions. services are uniform on [0.5, 1.5], which bounds the
+// lookahead from below, and every server is 70% busy.
+Network GetRingNetwork(int n_node) {
+  Network network;
+
+  for(int i = 0; i < n_node; i++)
+    network.AddNode(TimeModel::Uniform(0.5, 1.5));
+
+  for(int i = 0; i < n_node; i++) {
+    network.AddRoute(i, (i + 1) % n_node, 0.45);
+    network.AddRoute(i, (i + n_node / 2 + 1) % n_node, 0.45);
+    network.AddSource(i, TimeModel::Exponential(1 / 0.07));
+  }
+
+  return network;
+}
+
+bool IsSame(NetworkMetrics& a, NetworkMetrics& b) {
+  if(a.nodes.size() != b.nodes.size()) return false;
+
+  for(size_t i = 0; i < a.nodes.size(); i++) {
+    NodeMetrics &x = a.nodes[i], &y = b.nodes[i];
+    if(x.service != y.service || x.wait != y.wait || x.n_waited != y.n_waited
+       || x.n_customer != y.n_customer || x.spent != y.spent || x.n_exit != y.n_exit
+       || x.last_exit != y.last_exit)
+      return false;
+  }
+
+  return a.r == b.r && a.n == b.n && a.clock == b.clock && a.n_customer == b.n_customer;
+}
+
+// runs the sequential event engine, then the parallel one on 1, 2, 4, ...
+// threads up to max_thread, and checks each against the sequential result
+int main(int argc, char* argv[]) {
+  int n_node = 1024, max_thread = std::thread::hardware_concurrency();
+  long long n_warm_up = 100, n_customer = 1000;
+  uint64_t seed = 86456;
+
+  // options come in pairs:
+  //   nodes <n>: stations on the ring
+  //   threads <n>: largest thread count, the hardware threads by default
+  //   customers <n>, warm_up <n>: per source
+  //   seed <n>
+  for(int i = 1; i + 1 < argc; i += 2) {
+    std::string option = argv[i], value = argv[i + 1];
+
+    if(option == "nodes") {
+      n_node = std::stoi(value);
+    }
+    else if(option == "threads") {
+      max_thread = std::stoi(value);
+    }
+    else if(option == "customers") {
+      n_customer = std::stoll(value);
+    }
+    else if(option == "warm_up") {
+      n_warm_up = std::stoll(value);
+    }
+    else if(option == "seed") {
+      seed = std::stoull(value);
+    }
+  }
+  if(max_thread < 1) max_thread = 1;
+
+  Network network = GetRingNetwork(n_node);
+
+  auto start = std::chrono::steady_clock::now();
+  NetworkMetrics sequential = RunNetworkSimulation(network, n_warm_up, n_customer, seed, kEvent);
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  double sequential_seconds = elapsed.count();
+
+  std::cout << "###Parallel Scaling###" << std::endl
+            << "Nodes: " << n_node << ", customers: " << sequential.n_customer
+            << ", R: " << sequential.r << std::endl
+            << std::setw(8) << "threads" << std::setw(12) << "seconds" << std::setw(12) << "speedup"
+            << std::setw(12) << "windows" << std::setw(8) << "exact" << std::endl
+            << std::setw(8) << "seq" << std::setw(12) << sequential_seconds << std::setw(12) << 1
+            << std::setw(12) << "-" << std::setw(8) << "-" << std::endl;
+
+  for(int n_thread = 1; n_thread <= max_thread; n_thread *= 2) {
+    ParallelSimulator simulator(network, seed, n_thread);
+
+    start = std::chrono::steady_clock::now();
+    NetworkMetrics parallel = simulator.RunSimulation(n_warm_up, n_customer);
+    elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << std::setw(8) << n_thread << std::setw(12) << elapsed.count()
+              << std::setw(12) << sequential_seconds / elapsed.count()
+              << std::setw(12) << simulator.GetNWindow()
+              << std::setw(8) << (IsSame(sequential, parallel) ? "yes" : "no") << std::endl;
+  }
+
+  return 0;
+}
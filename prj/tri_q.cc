@@ -0,0 +1,69 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "network.h"
+
+using namespace queue_network;
+
+// the network of tri_q.f95: server 1 feeds server 2 with probability p and
+// server 3 otherwise. times are means of exponentials, as in the Fortran
+int main(int argc, char* argv[]) {
+  long long n_warm_up = 100000, n_customer = 5000000;
+  uint64_t seed = 86456;
+  double arrival = 1, service[] = {2, 4, 3}, p = 0.4;
+  int n_server = 1;
+  EngineType engine = kAuto;
+
+  // options come in pairs:
+  //   customers <n>, warm_up <n>, seed <n>
+  //   arrival <mean>, service_1, service_2, service_3 <mean>, p <probability>
+  //   servers <n>: servers at every node, above 1 needs the event engine
+  //   engine <auto|lindley|event>
+  for(int i = 1; i + 1 < argc; i += 2) {
+    std::string option = argv[i], value = argv[i + 1];
+
+    if(option == "customers") {
+      n_customer = std::stoll(value);
+    }
+    else if(option == "warm_up") {
+      n_warm_up = std::stoll(value);
+    }
+    else if(option == "seed") {
+      seed = std::stoull(value);
+    }
+    else if(option == "arrival") {
+      arrival = std::stod(value);
+    }
+    else if(option == "service_1" || option == "service_2" || option == "service_3") {
+      service[option.back() - '1'] = std::stod(value);
+    }
+    else if(option == "p") {
+      p = std::stod(value);
+    }
+    else if(option == "servers") {
+      n_server = std::stoi(value);
+    }
+    else if(option == "engine") {
+      engine = value == "lindley" ? kLindley : value == "event" ? kEvent : kAuto;
+    }
+  }
+
+  Network network;
+  for(int i = 0; i < 3; i++)
+    network.AddNode(TimeModel::Exponential(service[i]), n_server);
+  network.AddRoute(0, 1, p);
+  network.AddRoute(0, 2, 1 - p);
+  network.AddSource(0, TimeModel::Exponential(arrival));
+
+  Simulator simulator(network, seed);
+  auto start = std::chrono::steady_clock::now();
+  NetworkMetrics metrics = simulator.RunSimulation(n_warm_up, n_customer, engine);
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  PrintMetrics(metrics);
+  std::cout << (simulator.GetEngine() == kLindley ? "lindley" : "event") << " engine, "
+            << elapsed.count() << " s" << std::endl;
+
+  return 0;
+}